@@ -1,5 +1,21 @@
+#include <algorithm>
 #include "ast.hpp"
 
+auto kindName(StatementKind kind) -> const char* {
+    switch (kind) {
+        case StatementKind::Print: return "Print";
+        case StatementKind::Input: return "Input";
+        case StatementKind::ShiftLeft: return "ShiftLeft";
+        case StatementKind::ShiftRight: return "ShiftRight";
+        case StatementKind::Loop: return "Loop";
+        case StatementKind::Increment: return "Increment";
+        case StatementKind::Decrement: return "Decrement";
+        case StatementKind::ClosedForm: return "ClosedForm";
+    }
+
+    return "Unknown";
+}
+
 auto PrintStatement::accept(Visitor& visitor) -> void { visitor.visit(*this); }
 
 auto InputStatement::accept(Visitor& visitor) -> void { visitor.visit(*this); }
@@ -13,3 +29,19 @@ auto LoopStatement::accept(Visitor& visitor) -> void { visitor.visit(*this); }
 auto IncrementStatement::accept(Visitor& visitor) -> void { visitor.visit(*this); }
 
 auto DecrementStatement::accept(Visitor& visitor) -> void { visitor.visit(*this); }
+
+auto ClosedFormStatement::accept(Visitor& visitor) -> void { visitor.visit(*this); }
+
+ClosedFormStatement::ClosedFormStatement(std::vector<std::pair<long long, Polynomial>> assignments, bool guarded)
+    : assignments(std::move(assignments)), guarded(guarded) {
+    lowest = 0;
+    highest = 0;
+    for (auto& [offset, polynomial] : this->assignments) {
+        lowest = std::min(lowest, offset);
+        highest = std::max(highest, offset);
+        for (auto variable : polynomial.variables()) {
+            lowest = std::min(lowest, variable);
+            highest = std::max(highest, variable);
+        }
+    }
+}
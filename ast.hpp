@@ -3,6 +3,7 @@
 #include <utility>
 #include <vector>
 #include <memory>
+#include "polynomial.hpp"
 
 enum StatementKind {
     Print,
@@ -11,13 +12,18 @@ enum StatementKind {
     ShiftRight,
     Loop,
     Increment,
-    Decrement
+    Decrement,
+    ClosedForm
 };
 
+auto kindName(StatementKind kind) -> const char*;
+
 class Visitor;
 
 class Statement {
 public:
+    virtual ~Statement() = default;
+
     virtual auto kind() const -> StatementKind = 0;
     virtual auto accept(Visitor& visitor) -> void = 0;
 };
@@ -84,6 +90,24 @@ public:
     auto accept(Visitor& visitor) -> void override;
 };
 
+// A loop replaced by its effect after all iterations. Every assignment is computed
+// from the cell values before the statement, relative to the current cell. Unless
+// guarded, the assignments are the identity when the current cell is zero, so they
+// can be applied without checking it.
+class ClosedFormStatement : public Statement {
+public:
+    std::vector<std::pair<long long, Polynomial>> assignments;
+    bool guarded;
+    // Lowest and highest offset read or written, relative to the pointer.
+    long long lowest;
+    long long highest;
+
+    auto kind() const -> StatementKind override { return StatementKind::ClosedForm; }
+    auto accept(Visitor& visitor) -> void override;
+
+    explicit ClosedFormStatement(std::vector<std::pair<long long, Polynomial>> assignments, bool guarded);
+};
+
 class Visitor {
 public:
     virtual auto visit(const PrintStatement& printStatement) -> void { };
@@ -93,6 +117,7 @@ public:
     virtual auto visit(const LoopStatement& loopStatement) -> void { };
     virtual auto visit(const IncrementStatement& incrementStatement) -> void { };
     virtual auto visit(const DecrementStatement& decrementStatement) -> void { };
+    virtual auto visit(const ClosedFormStatement& closedFormStatement) -> void { };
 };
 
 class Listener : public Visitor {
@@ -103,6 +128,7 @@ protected:
     virtual auto visitShiftRightStatement(const ShiftRightStatement& shiftRightStatement) -> void { };
     virtual auto visitIncrementStatement(const IncrementStatement& incrementStatement) -> void { };
     virtual auto visitDecrementStatement(const DecrementStatement& decrementStatement) -> void { };
+    virtual auto visitClosedFormStatement(const ClosedFormStatement& closedFormStatement) -> void { };
     virtual auto enterLoopStatement(const LoopStatement& loopStatement) -> void { };
     virtual auto exitLoopStatement(const LoopStatement& loopStatement) -> void { };
 private:
@@ -112,6 +138,7 @@ private:
     auto visit(const ShiftRightStatement& shiftRightStatement) -> void override { visitShiftRightStatement(shiftRightStatement); };
     auto visit(const IncrementStatement& incrementStatement) -> void override { visitIncrementStatement(incrementStatement); };
     auto visit(const DecrementStatement& decrementStatement) -> void override { visitDecrementStatement(decrementStatement); };
+    auto visit(const ClosedFormStatement& closedFormStatement) -> void override { visitClosedFormStatement(closedFormStatement); };
     auto visit(const LoopStatement& loopStatement) -> void override {
         enterLoopStatement(loopStatement);
 
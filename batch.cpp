@@ -0,0 +1,321 @@
+#include <algorithm>
+#include "batch.hpp"
+
+// Lanes are padded to a multiple of this so the per-lane loops have no scalar tail.
+static constexpr std::size_t laneAlignment = 16;
+
+auto BatchInterpreter::run(const std::vector<std::string>& inputs) -> std::vector<std::string> {
+    auto outputs = std::vector<std::string>(inputs.size());
+    for (std::size_t first = 0; first < inputs.size(); first += width)
+        runGroup(inputs.data() + first, outputs.data() + first, std::min(width, inputs.size() - first));
+
+    return outputs;
+}
+
+BatchInterpreter::BatchInterpreter(const std::vector<std::unique_ptr<Statement>>& statements, std::size_t width)
+    : width(std::max<std::size_t>(width, 1)) {
+    operations = {};
+    flatten(statements);
+}
+
+auto BatchInterpreter::flatten(const std::vector<std::unique_ptr<Statement>>& statements) -> std::pair<long long, bool> {
+    long long moved = 0;
+    auto balanced = true;
+
+    for (auto& statement : statements) {
+        switch (statement->kind()) {
+            case StatementKind::Print:
+                operations.push_back({ OperationKind::Print, 0, 0, false, nullptr });
+                break;
+            case StatementKind::Input:
+                operations.push_back({ OperationKind::Input, 0, 0, false, nullptr });
+                break;
+            case StatementKind::ShiftLeft: {
+                auto by = dynamic_cast<const ShiftLeftStatement&>(*statement).by;
+                operations.push_back({ OperationKind::Move, -by, 0, false, nullptr });
+                moved -= by;
+                break;
+            }
+            case StatementKind::ShiftRight: {
+                auto by = dynamic_cast<const ShiftRightStatement&>(*statement).by;
+                operations.push_back({ OperationKind::Move, by, 0, false, nullptr });
+                moved += by;
+                break;
+            }
+            case StatementKind::Increment:
+                operations.push_back({ OperationKind::Add, dynamic_cast<const IncrementStatement&>(*statement).by, 0, false, nullptr });
+                break;
+            case StatementKind::Decrement:
+                operations.push_back({ OperationKind::Add, -dynamic_cast<const DecrementStatement&>(*statement).by, 0, false, nullptr });
+                break;
+            case StatementKind::ClosedForm:
+                operations.push_back({ OperationKind::ClosedForm, 0, 0, false, dynamic_cast<const ClosedFormStatement*>(statement.get()) });
+                break;
+            case StatementKind::Loop: {
+                auto open = operations.size();
+                operations.push_back({ OperationKind::Open, 0, 0, false, nullptr });
+
+                auto [bodyMoved, bodyBalanced] = flatten(dynamic_cast<const LoopStatement&>(*statement).statements);
+                auto loopBalanced = bodyBalanced && bodyMoved == 0;
+
+                auto close = operations.size();
+                operations.push_back({ OperationKind::Close, 0, open, loopBalanced, nullptr });
+                operations[open].jump = close;
+                operations[open].balanced = loopBalanced;
+                balanced = balanced && loopBalanced;
+                break;
+            }
+        }
+    }
+
+    return { moved, balanced };
+}
+
+auto BatchInterpreter::reserve(std::vector<unsigned char>& tape, long long& origin, std::size_t lanes, long long low, long long high) -> void {
+    auto rows = static_cast<long long>(tape.size() / lanes);
+
+    if (low + origin < 0) {
+        auto missing = std::max(-(low + origin), rows);
+        tape.insert(tape.begin(), missing * lanes, 0);
+        origin += missing;
+        rows += missing;
+    }
+
+    if (high + origin >= rows) {
+        auto missing = std::max(high + origin - rows + 1, rows);
+        tape.resize(tape.size() + missing * lanes, 0);
+    }
+}
+
+auto BatchInterpreter::runGroup(const std::string* inputs, std::string* outputs, std::size_t count) -> void {
+    auto lanes = (count + laneAlignment - 1) / laneAlignment * laneAlignment;
+    auto group = Group {
+        lanes,
+        std::vector<unsigned char>(lanes * 64, 0),
+        32,
+        0,
+        std::vector<unsigned char>(lanes, 0),
+        {},
+        std::vector<std::size_t>(lanes, 0)
+    };
+
+    std::fill(group.active.begin(), group.active.begin() + count, 0xFF);
+
+    auto condition = std::vector<unsigned char>(lanes);
+    auto values = std::vector<unsigned char>();
+
+    // Computes which active lanes see a non-zero cell, and whether that is all or none of them.
+    auto test = [&](unsigned char* row, bool& any, bool& all) {
+        unsigned char anyBits = 0;
+        unsigned char allBits = 0xFF;
+        for (std::size_t lane = 0; lane < lanes; lane++) {
+            condition[lane] = group.active[lane] & (row[lane] != 0 ? 0xFF : 0);
+            anyBits |= condition[lane];
+            allBits &= condition[lane] | ~group.active[lane];
+        }
+
+        any = anyBits != 0;
+        all = allBits != 0;
+    };
+
+    for (std::size_t pc = 0; pc < operations.size(); pc++) {
+        auto& operation = operations[pc];
+        auto row = group.tape.data() + (group.pointer + group.origin) * lanes;
+
+        switch (operation.kind) {
+            case OperationKind::Add: {
+                auto amount = static_cast<unsigned char>(operation.argument);
+                for (std::size_t lane = 0; lane < lanes; lane++)
+                    row[lane] += amount & group.active[lane];
+                break;
+            }
+            case OperationKind::Move:
+                group.pointer += operation.argument;
+                reserve(group.tape, group.origin, lanes, group.pointer, group.pointer);
+                break;
+            case OperationKind::Print:
+                for (std::size_t lane = 0; lane < count; lane++) {
+                    if (group.active[lane])
+                        outputs[lane].push_back(static_cast<char>(row[lane]));
+                }
+                break;
+            case OperationKind::Input:
+                for (std::size_t lane = 0; lane < count; lane++) {
+                    if (!group.active[lane])
+                        continue;
+
+                    auto& consumed = group.consumed[lane];
+                    row[lane] = consumed < inputs[lane].size() ? inputs[lane][consumed++] : 255;
+                }
+                break;
+            case OperationKind::ClosedForm: {
+                auto& assignments = operation.closedForm->assignments;
+                for (auto& [offset, polynomial] : assignments) {
+                    for (auto variable : polynomial.variables())
+                        reserve(group.tape, group.origin, lanes, group.pointer + variable, group.pointer + variable);
+                    reserve(group.tape, group.origin, lanes, group.pointer + offset, group.pointer + offset);
+                }
+
+                auto base = group.tape.data() + group.origin * lanes;
+                for (std::size_t lane = 0; lane < count; lane++) {
+                    if (!group.active[lane])
+                        continue;
+
+                    auto cell = [&](long long offset) -> unsigned char& {
+                        return base[(group.pointer + offset) * lanes + lane];
+                    };
+                    if (operation.closedForm->guarded && cell(0) == 0)
+                        continue;
+
+                    values.clear();
+                    for (auto& [offset, polynomial] : assignments)
+                        values.push_back(polynomial.evaluate(cell));
+                    for (std::size_t i = 0; i < values.size(); i++)
+                        cell(assignments[i].first) = values[i];
+                }
+                break;
+            }
+            case OperationKind::Open: {
+                bool any, all;
+                test(row, any, all);
+
+                if (operation.balanced) {
+                    if (!any) {
+                        pc = operation.jump;
+                        break;
+                    }
+
+                    group.masks.push_back(group.active);
+                    group.active = condition;
+                    break;
+                }
+
+                if (!any) {
+                    pc = operation.jump;
+                } else if (!all) {
+                    // Entering lanes keep their place in the group when they are the majority.
+                    auto entering = std::count_if(condition.begin(), condition.end(), [](auto bits) { return bits != 0; });
+                    auto alive = std::count_if(group.active.begin(), group.active.end(), [](auto bits) { return bits != 0; });
+                    auto leaving = std::vector<unsigned char>(lanes);
+                    for (std::size_t lane = 0; lane < lanes; lane++)
+                        leaving[lane] = group.active[lane] & ~condition[lane];
+
+                    if (entering * 2 >= alive) {
+                        eject(group, operation.jump + 1, group.pointer, leaving, inputs, outputs);
+                    } else {
+                        eject(group, pc + 1, group.pointer, condition, inputs, outputs);
+                        pc = operation.jump;
+                    }
+                }
+                break;
+            }
+            case OperationKind::Close: {
+                bool any, all;
+                test(row, any, all);
+
+                if (operation.balanced) {
+                    if (any) {
+                        group.active = condition;
+                        pc = operation.jump;
+                        break;
+                    }
+
+                    group.active = group.masks.back();
+                    group.masks.pop_back();
+                    break;
+                }
+
+                if (all) {
+                    pc = operation.jump;
+                } else if (any) {
+                    auto looping = std::count_if(condition.begin(), condition.end(), [](auto bits) { return bits != 0; });
+                    auto alive = std::count_if(group.active.begin(), group.active.end(), [](auto bits) { return bits != 0; });
+                    auto leaving = std::vector<unsigned char>(lanes);
+                    for (std::size_t lane = 0; lane < lanes; lane++)
+                        leaving[lane] = group.active[lane] & ~condition[lane];
+
+                    if (looping * 2 >= alive) {
+                        eject(group, pc + 1, group.pointer, leaving, inputs, outputs);
+                        pc = operation.jump;
+                    } else {
+                        eject(group, operation.jump + 1, group.pointer, condition, inputs, outputs);
+                    }
+                }
+                break;
+            }
+        }
+
+        // Only unbalanced loops eject lanes and none of them runs under a mask, so no
+        // active lanes means every lane has finished in the scalar interpreter.
+        if (std::none_of(group.active.begin(), group.active.end(), [](auto bits) { return bits != 0; }))
+            break;
+    }
+}
+
+auto BatchInterpreter::eject(Group& group, std::size_t pc, long long pointer, const std::vector<unsigned char>& lanes,
+                             const std::string* inputs, std::string* outputs) -> void {
+    auto rows = group.tape.size() / group.lanes;
+
+    for (std::size_t lane = 0; lane < group.lanes; lane++) {
+        if (!lanes[lane])
+            continue;
+
+        auto tape = std::vector<unsigned char>(rows);
+        for (std::size_t row = 0; row < rows; row++)
+            tape[row] = group.tape[row * group.lanes + lane];
+
+        group.active[lane] = 0;
+        runScalar(std::move(tape), group.origin, pointer, pc, inputs[lane], group.consumed[lane], outputs[lane]);
+    }
+}
+
+auto BatchInterpreter::runScalar(std::vector<unsigned char> tape, long long origin, long long pointer, std::size_t pc,
+                                 const std::string& input, std::size_t consumed, std::string& output) -> void {
+    for (; pc < operations.size(); pc++) {
+        auto& operation = operations[pc];
+        auto& cell = tape[pointer + origin];
+
+        switch (operation.kind) {
+            case OperationKind::Add:
+                cell += static_cast<unsigned char>(operation.argument);
+                break;
+            case OperationKind::Move:
+                pointer += operation.argument;
+                reserve(tape, origin, 1, pointer, pointer);
+                break;
+            case OperationKind::Print:
+                output.push_back(static_cast<char>(cell));
+                break;
+            case OperationKind::Input:
+                cell = consumed < input.size() ? input[consumed++] : 255;
+                break;
+            case OperationKind::ClosedForm: {
+                auto& assignments = operation.closedForm->assignments;
+                if (operation.closedForm->guarded && cell == 0)
+                    break;
+
+                for (auto& [offset, polynomial] : assignments) {
+                    for (auto variable : polynomial.variables())
+                        reserve(tape, origin, 1, pointer + variable, pointer + variable);
+                    reserve(tape, origin, 1, pointer + offset, pointer + offset);
+                }
+
+                auto read = [&](long long offset) { return tape[pointer + offset + origin]; };
+                auto values = std::vector<unsigned char>();
+                for (auto& [offset, polynomial] : assignments)
+                    values.push_back(polynomial.evaluate(read));
+                for (std::size_t i = 0; i < values.size(); i++)
+                    tape[pointer + assignments[i].first + origin] = values[i];
+                break;
+            }
+            case OperationKind::Open:
+                if (cell == 0)
+                    pc = operation.jump;
+                break;
+            case OperationKind::Close:
+                if (cell != 0)
+                    pc = operation.jump;
+                break;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ast.hpp"
+
+// Runs one tree over many inputs in lockstep. The tapes of all lanes are interleaved
+// cell by cell, so every cell operation is a loop over adjacent lanes that the compiler
+// vectorizes. Inside loops that return the pointer to where they started, lanes that
+// are done are simply masked off. When lanes disagree on a loop that moves the pointer
+// their tapes would drift apart, so the smaller side continues on its own.
+class BatchInterpreter {
+public:
+    // Returns the output of every input, in the same order.
+    auto run(const std::vector<std::string>& inputs) -> std::vector<std::string>;
+
+    explicit BatchInterpreter(const std::vector<std::unique_ptr<Statement>>& statements, std::size_t width);
+private:
+    enum OperationKind {
+        Add,
+        Move,
+        Print,
+        Input,
+        Open,
+        Close,
+        ClosedForm
+    };
+
+    struct Operation {
+        OperationKind kind;
+        long long argument;
+        // For Open and Close, the index of the matching bracket.
+        std::size_t jump;
+        // For Open and Close, whether the loop leaves the pointer where it started.
+        bool balanced;
+        const ClosedFormStatement* closedForm;
+    };
+
+    // The part of a run shared by all lanes of one chunk.
+    struct Group {
+        std::size_t lanes;
+        std::vector<unsigned char> tape;
+        long long origin;
+        long long pointer;
+        // Lanes the current instruction applies to, ejected lanes are never active again.
+        std::vector<unsigned char> active;
+        std::vector<std::vector<unsigned char>> masks;
+        std::vector<std::size_t> consumed;
+    };
+
+    std::vector<Operation> operations;
+    const std::size_t width;
+
+    auto flatten(const std::vector<std::unique_ptr<Statement>>& statements) -> std::pair<long long, bool>;
+    auto runGroup(const std::string* inputs, std::string* outputs, std::size_t count) -> void;
+    auto runScalar(std::vector<unsigned char> tape, long long origin, long long pointer, std::size_t pc,
+                   const std::string& input, std::size_t consumed, std::string& output) -> void;
+    auto eject(Group& group, std::size_t pc, long long pointer, const std::vector<unsigned char>& lanes,
+               const std::string* inputs, std::string* outputs) -> void;
+
+    static auto reserve(std::vector<unsigned char>& tape, long long& origin, std::size_t lanes, long long low, long long high) -> void;
+};
@@ -0,0 +1,150 @@
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include "cache.hpp"
+#include "hash.hpp"
+
+// Bump whenever the meaning of a program or the entry format changes, so stale outputs
+// are never replayed.
+static constexpr unsigned int cacheVersion = 2;
+
+// Entries start with the version, the program hash, and the input or a dash when the
+// program reads none, followed by the output.
+static auto entryHeader(unsigned long long program, const std::optional<std::string>& input) -> std::string {
+    auto header = std::ostringstream();
+    header << "bfc-cache " << cacheVersion << '\n' << std::hex << program << std::dec << '\n';
+    if (input)
+        header << input->size() << '\n' << *input;
+    else header << "-\n";
+
+    return header.str();
+}
+
+class InputFinder : public Listener {
+public:
+    bool found;
+
+    explicit InputFinder() {
+        found = false;
+    }
+protected:
+    auto visitInputStatement(const InputStatement& inputStatement) -> void override { found = true; }
+};
+
+auto readsInput(const std::vector<std::unique_ptr<Statement>>& statements) -> bool {
+    auto finder = InputFinder();
+    for (auto& statement : statements)
+        statement->accept(finder);
+
+    return finder.found;
+}
+
+auto TeeBuffer::overflow(int_type character) -> int_type {
+    if (traits_type::eq_int_type(character, traits_type::eof()))
+        return traits_type::not_eof(character);
+
+    if (!dropped && traits_type::eq_int_type(second->sputc(traits_type::to_char_type(character)), traits_type::eof()))
+        dropped = true;
+
+    return first->sputc(traits_type::to_char_type(character));
+}
+
+auto TeeBuffer::xsputn(const char_type* data, std::streamsize count) -> std::streamsize {
+    if (!dropped && second->sputn(data, count) != count)
+        dropped = true;
+
+    return first->sputn(data, count);
+}
+
+auto TeeBuffer::sync() -> int {
+    if (!dropped && second->pubsync() != 0)
+        dropped = true;
+
+    return first->pubsync();
+}
+
+auto OutputCache::key(unsigned long long program, const std::optional<std::string>& input) -> unsigned long long {
+    auto hasher = Hasher();
+    hasher.update(cacheVersion);
+    hasher.update(program);
+    hasher.update(input.has_value());
+    if (input)
+        hasher.update(input->data(), input->size());
+
+    return hasher.digest();
+}
+
+auto OutputCache::replay(unsigned long long program, const std::optional<std::string>& input) -> bool {
+    auto stream = std::ifstream(path(key(program, input)), std::ios::binary);
+    if (!stream.good())
+        return false;
+
+    auto contents = std::ostringstream();
+    contents << stream.rdbuf();
+    auto entry = contents.str();
+
+    auto header = entryHeader(program, input);
+    if (entry.compare(0, header.size(), header) != 0)
+        return false;
+
+    std::fflush(stdout);
+    auto data = entry.data() + header.size();
+    auto remaining = entry.size() - header.size();
+    while (remaining > 0) {
+        auto count = ::write(STDOUT_FILENO, data, remaining);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0) {
+            // Fails like writing the output through std::cout would have.
+            std::cout.setstate(std::ios::badbit);
+            break;
+        }
+
+        data += count;
+        remaining -= count;
+    }
+
+    return true;
+}
+
+auto OutputCache::record(unsigned long long program, const std::optional<std::string>& input) -> std::ofstream* {
+    finalPath = path(key(program, input));
+    recordingPath = finalPath + "." + std::to_string(getpid()) + ".tmp";
+    recording = std::ofstream(recordingPath, std::ios::binary);
+    recording << entryHeader(program, input);
+    if (!recording.good()) {
+        recording.close();
+        unlink(recordingPath.c_str());
+        return nullptr;
+    }
+
+    return &recording;
+}
+
+auto OutputCache::commit() -> bool {
+    recording.close();
+    if (recording.fail() || std::rename(recordingPath.c_str(), finalPath.c_str()) != 0) {
+        unlink(recordingPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+OutputCache::OutputCache(std::string directory) : directory(std::move(directory)) { }
+
+OutputCache::~OutputCache() {
+    // A run that never reached commit() must not leave half an output behind.
+    if (recording.is_open()) {
+        recording.close();
+        unlink(recordingPath.c_str());
+    }
+}
+
+auto OutputCache::path(unsigned long long key) const -> std::string {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", key);
+    return directory + "/" + name + ".out";
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <fstream>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+
+// Programs without input statements produce the same output for every input.
+auto readsInput(const std::vector<std::unique_ptr<Statement>>& statements) -> bool;
+
+// Forwards everything written to it to two stream buffers. The second one only gets a
+// copy: once writing to it fails, it is dropped and failed() tells, while the first keeps
+// receiving everything.
+class TeeBuffer : public std::streambuf {
+public:
+    explicit TeeBuffer(std::streambuf* first, std::streambuf* second) : first(first), second(second), dropped(false) { }
+
+    auto failed() const -> bool { return dropped; }
+protected:
+    auto overflow(int_type character) -> int_type override;
+    auto xsputn(const char_type* data, std::streamsize count) -> std::streamsize override;
+    auto sync() -> int override;
+private:
+    std::streambuf* first;
+    std::streambuf* second;
+    bool dropped;
+};
+
+// Outputs of earlier runs stored on disk, one file per run. A run is the hash of the
+// tree and, if the program reads any, its complete input. Entries are named after a
+// digest of both but also store them, so a digest collision is a miss, not a replay.
+class OutputCache {
+public:
+    // Writes a stored output to stdout, returns false when there is none.
+    auto replay(unsigned long long program, const std::optional<std::string>& input) -> bool;
+
+    // Starts recording a run, the entry only becomes visible once commit() succeeds.
+    // Returns nullptr and false respectively when the directory cannot be written, the run is just not cached.
+    auto record(unsigned long long program, const std::optional<std::string>& input) -> std::ofstream*;
+    auto commit() -> bool;
+
+    explicit OutputCache(std::string directory);
+    OutputCache(const OutputCache&) = delete;
+    auto operator =(const OutputCache&) -> OutputCache& = delete;
+
+    ~OutputCache();
+private:
+    const std::string directory;
+    std::ofstream recording;
+    std::string recordingPath;
+    std::string finalPath;
+
+    static auto key(unsigned long long program, const std::optional<std::string>& input) -> unsigned long long;
+    auto path(unsigned long long key) const -> std::string;
+};
@@ -0,0 +1,180 @@
+#include <set>
+#include "closedform.hpp"
+
+// Polynomials grow with every level of nesting, past this the evaluation stops paying off.
+static constexpr std::size_t maximumTerms = 32;
+
+// Runs a loop body once over polynomials of the cell values it started with.
+class SymbolicExecutor : public Visitor {
+public:
+    std::map<long long, Polynomial> cells;
+    long long pointer;
+    bool failed;
+
+    auto visit(const PrintStatement& printStatement) -> void override { failed = true; }
+    auto visit(const InputStatement& inputStatement) -> void override { failed = true; }
+    auto visit(const LoopStatement& loopStatement) -> void override { failed = true; }
+    auto visit(const ShiftLeftStatement& shiftLeftStatement) -> void override { pointer -= shiftLeftStatement.by; }
+    auto visit(const ShiftRightStatement& shiftRightStatement) -> void override { pointer += shiftRightStatement.by; }
+
+    auto visit(const IncrementStatement& incrementStatement) -> void override {
+        cells[pointer] = value(pointer) + Polynomial::constant(static_cast<unsigned char>(incrementStatement.by));
+    }
+
+    auto visit(const DecrementStatement& decrementStatement) -> void override {
+        cells[pointer] = value(pointer) - Polynomial::constant(static_cast<unsigned char>(decrementStatement.by));
+    }
+
+    auto visit(const ClosedFormStatement& closedFormStatement) -> void override {
+        // A guarded inner loop is only polynomial once we know its counter is non-zero.
+        if (closedFormStatement.guarded) {
+            failed = true;
+            return;
+        }
+
+        auto updated = std::vector<std::pair<long long, Polynomial>>();
+        for (auto& [offset, polynomial] : closedFormStatement.assignments)
+            updated.emplace_back(pointer + offset, polynomial.shift(pointer).substitute(cells));
+
+        for (auto& [offset, polynomial] : updated) {
+            if (polynomial.terms.size() > maximumTerms)
+                failed = true;
+
+            cells[offset] = std::move(polynomial);
+        }
+    }
+
+    explicit SymbolicExecutor() {
+        cells = {};
+        pointer = 0;
+        failed = false;
+    }
+private:
+    auto value(long long offset) -> Polynomial {
+        auto search = cells.find(offset);
+        return search == cells.end() ? Polynomial::variable(offset) : search->second;
+    }
+};
+
+static auto inverse(unsigned char odd) -> unsigned char {
+    // Newton's iteration doubles the number of correct low bits each step.
+    unsigned char result = odd;
+    for (auto i = 0; i < 3; i++)
+        result *= static_cast<unsigned char>(2 - odd * result);
+
+    return result;
+}
+
+// With x the cells before the loop, d the step of the counter and T the body as a
+// polynomial map, the loop runs n = -x0 / d times. Cells are accepted when either
+//   - they are stable: after the first iteration T no longer changes them, or
+//   - they accumulate: T adds an amount that only depends on stable or untouched cells,
+//     so after n iterations they hold T(x) + (n - 1) * that amount.
+static auto analyze(const LoopStatement& loopStatement) -> std::unique_ptr<ClosedFormStatement> {
+    auto executor = SymbolicExecutor();
+    for (auto& statement : loopStatement.statements) {
+        statement->accept(executor);
+        if (executor.failed)
+            return nullptr;
+    }
+
+    if (executor.pointer != 0)
+        return nullptr;
+
+    auto& body = executor.cells;
+    for (auto it = body.begin(); it != body.end();) {
+        if (it->second == Polynomial::variable(it->first))
+            it = body.erase(it);
+        else ++it;
+    }
+
+    auto counter = body.find(0);
+    if (counter == body.end())
+        return nullptr;
+
+    auto step = counter->second - Polynomial::variable(0);
+    if (!step.isConstant() || step.constantTerm() % 2 == 0)
+        return nullptr;
+
+    auto stable = std::set<long long>();
+    for (auto& [offset, polynomial] : body) {
+        if (offset == 0)
+            continue;
+        if (polynomial.references(0))
+            return nullptr;
+
+        stable.insert(offset);
+    }
+
+    auto isFixed = [&](long long offset) {
+        return stable.count(offset) != 0 || body.find(offset) == body.end();
+    };
+
+    for (auto changed = true; changed;) {
+        changed = false;
+        for (auto it = stable.begin(); it != stable.end();) {
+            auto& polynomial = body[*it];
+            auto fixed = true;
+            for (auto offset : polynomial.variables())
+                fixed = fixed && isFixed(offset);
+
+            if (fixed && polynomial.substitute(body) == polynomial) {
+                ++it;
+                continue;
+            }
+
+            it = stable.erase(it);
+            changed = true;
+        }
+    }
+
+    auto iterations = Polynomial::constant(inverse(-step.constantTerm())) * Polynomial::variable(0);
+    auto assignments = std::vector<std::pair<long long, Polynomial>>();
+    for (auto& [offset, polynomial] : body) {
+        if (offset == 0) {
+            assignments.emplace_back(0, Polynomial::constant(0));
+            continue;
+        }
+
+        if (stable.count(offset) != 0) {
+            assignments.emplace_back(offset, polynomial);
+            continue;
+        }
+
+        auto increment = polynomial - Polynomial::variable(offset);
+        for (auto variable : increment.variables()) {
+            if (!isFixed(variable))
+                return nullptr;
+        }
+
+        auto total = polynomial + (iterations - Polynomial::constant(1)) * increment.substitute(body);
+        if (total.terms.size() > maximumTerms)
+            return nullptr;
+
+        assignments.emplace_back(offset, std::move(total));
+    }
+
+    auto zero = std::map<long long, Polynomial> { { 0, Polynomial::constant(0) } };
+    auto guarded = false;
+    for (auto& [offset, polynomial] : assignments)
+        guarded = guarded || polynomial.substitute(zero) != Polynomial::variable(offset).substitute(zero);
+
+    return std::make_unique<ClosedFormStatement>(std::move(assignments), guarded);
+}
+
+auto foldClosedForms(std::vector<std::unique_ptr<Statement>>& statements) -> void {
+    for (auto& statement : statements)
+        foldClosedForms(statement);
+}
+
+auto foldClosedForms(std::unique_ptr<Statement>& statement) -> void {
+    if (statement->kind() != StatementKind::Loop)
+        return;
+
+    auto& loop = dynamic_cast<LoopStatement&>(*statement);
+    foldClosedForms(loop.statements);
+
+    auto folded = analyze(loop);
+    if (folded)
+        statement = std::move(folded);
+}
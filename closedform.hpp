@@ -0,0 +1,9 @@
+#pragma once
+
+#include "ast.hpp"
+
+// Replaces loops that leave the pointer where it started and whose effect on the
+// tape is polynomial in the cells they read with a ClosedFormStatement. Inner loops
+// are folded first, so nests such as [>[->+<]<-] collapse as a whole.
+auto foldClosedForms(std::vector<std::unique_ptr<Statement>>& statements) -> void;
+auto foldClosedForms(std::unique_ptr<Statement>& statement) -> void;
@@ -1,51 +1,433 @@
+#include <fstream>
+#include <unistd.h>
 #include "codegen.hpp"
 
+// A loop needs at least this many iterations over the whole run to be worth specializing.
+static constexpr unsigned long long hotIterations = 1000;
+// Average trip count from which hot loops get unrolled.
+static constexpr unsigned long long unrollTrips = 8;
+
+static constexpr const char* prologue =
+    "// Generated by bfc\n#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n\n";
+
+static constexpr const char* memorySetup =
+    "  unsigned char* memory = (unsigned char*) malloc(80000);\n  memset(memory, 0, 80000);\n  long long current = 40000;\n";
+
+auto CodeGen::finish() -> void {
+    if (splitThreshold == 0) {
+        indentation();
+        writer->write("free(memory);\n}");
+        appendColdFunctions();
+        writer->close();
+        return;
+    }
+
+    endPart();
+    writer = std::make_unique<FileWriter>(path);
+    writer->write(prologue);
+
+    for (auto part = 0ull; part < parts; part++) {
+        writer->write("long long bfc_part_");
+        writer->write(part);
+        writer->write("(unsigned char* memory, long long current);\n");
+    }
+
+    writer->write("\nint main() {\n");
+    writer->write(memorySetup);
+
+    for (auto part = 0ull; part < parts; part++) {
+        writer->write("  current = bfc_part_");
+        writer->write(part);
+        writer->write("(memory, current);\n");
+    }
+
+    writer->write("  free(memory);\n}");
+    appendColdFunctions();
+    writer->close();
+}
+
+CodeGen::CodeGen(std::string path, unsigned long long splitThreshold)
+    : path(std::move(path)), splitThreshold(splitThreshold) {
+    parts = 0;
+    indentLevel = 1;
+    indents = std::string(32, ' ');
+    profile = nullptr;
+    loopIndex = 0;
+    loopDepth = 0;
+    outlinedDepth = 0;
+    outlinedIndentLevel = 0;
+    tracksExtent = false;
+    loopConditions = {};
+
+    if (splitThreshold != 0) {
+        beginPart();
+        return;
+    }
+
+    writer = std::make_unique<FileWriter>(this->path);
+    writer->write(prologue);
+    writer->write("int main() {\n");
+    writer->write(memorySetup);
+}
+
+CodeGen::CodeGen(std::string path, std::unique_ptr<FileWriter> writer)
+    : path(std::move(path)), splitThreshold(0), writer(std::move(writer)) {
+    parts = 0;
+    indentLevel = 1;
+    indents = std::string(32, ' ');
+    profile = nullptr;
+    loopIndex = 0;
+    loopDepth = 0;
+    outlinedDepth = 0;
+    outlinedIndentLevel = 0;
+    tracksExtent = false;
+    loopConditions = {};
+}
+
+auto CodeGen::use(const Profile* profile) -> void {
+    this->profile = profile;
+}
+
+auto CodeGen::emitFunction(const std::string& path, const std::string& name, const LoopStatement& loopStatement) -> void {
+    auto writer = std::make_unique<FileWriter>(path);
+    writer->write("// Generated by bfc\n#include <stdio.h>\n\n");
+    writer->write("typedef struct { void* context; int (*get)(void*); void (*put)(void*, int); } bfc_io;\n");
+    writer->write("#define getchar() io->get(io->context)\n#define putchar(c) io->put(io->context, (c))\n\n");
+    writer->write("long long ");
+    writer->write(name);
+    writer->write("(unsigned char* memory, long long current, const bfc_io* io, long long* extent) {\n");
+    writer->write("  long long lowest = extent[0];\n  long long highest = extent[1];\n");
+
+    auto generator = CodeGen(path, std::move(writer));
+    generator.tracksExtent = true;
+    generator.enterLoopStatement(loopStatement);
+    for (auto& statement : loopStatement.statements)
+        statement->accept(generator);
+    generator.exitLoopStatement(loopStatement);
+
+    generator.writer->write("  extent[0] = lowest;\n  extent[1] = highest;\n  return current;\n}\n");
+    generator.writer->close();
+}
+
+auto CodeGen::partPath(unsigned long long part) const -> std::string {
+    auto suffix = ".part" + std::to_string(part) + ".c";
+    if (path.size() > 2 && path.compare(path.size() - 2, 2, ".c") == 0)
+        return path.substr(0, path.size() - 2) + suffix;
+
+    return path + suffix;
+}
+
+auto CodeGen::beginPart() -> void {
+    writer = std::make_unique<FileWriter>(partPath(parts));
+    writer->write(prologue);
+    writer->write("long long bfc_part_");
+    writer->write(parts);
+    writer->write("(unsigned char* memory, long long current) {\n");
+    parts++;
+}
+
+auto CodeGen::endPart() -> void {
+    writer->write("  return current;\n}\n");
+    writer->close();
+}
+
+auto CodeGen::split() -> void {
+    if (splitThreshold == 0 || indentLevel != 1 || writer->written() < splitThreshold)
+        return;
+
+    endPart();
+    beginPart();
+}
+
+auto CodeGen::cell(long long offset) -> void {
+    if (offset == 0) {
+        writer->write("memory[current]");
+        return;
+    }
+
+    writer->write(offset < 0 ? "memory[current - " : "memory[current + ");
+    writer->write(offset < 0 ? -offset : offset);
+    writer->write("]");
+}
+
 auto CodeGen::visitPrintStatement(const PrintStatement& printStatement) -> void {
+    split();
     indentation();
-    builder << "putchar(memory[current]);\n";
+    writer->write("putchar(memory[current]);\n");
 }
 
 auto CodeGen::visitInputStatement(const InputStatement& inputStatement) -> void {
+    split();
     indentation();
-    builder << "memory[current] = getchar();\n";
+    writer->write("memory[current] = getchar();\n");
 }
 
 auto CodeGen::visitShiftLeftStatement(const ShiftLeftStatement& shiftLeftStatement) -> void {
+    split();
     indentation();
-    if (shiftLeftStatement.by == 1)
-        builder << "current--;\n";
-    else builder << "current -= " << shiftLeftStatement.by << ";\n";
+    if (shiftLeftStatement.by == 1) {
+        writer->write("current--;\n");
+    } else {
+        writer->write("current -= ");
+        writer->write(shiftLeftStatement.by);
+        writer->write(";\n");
+    }
+
+    if (tracksExtent) {
+        indentation();
+        writer->write("if (current < lowest) lowest = current;\n");
+    }
 }
 
 auto CodeGen::visitShiftRightStatement(const ShiftRightStatement& shiftRightStatement) -> void {
+    split();
     indentation();
-    if (shiftRightStatement.by == 1)
-        builder << "current++;\n";
-    else builder << "current += " << shiftRightStatement.by << ";\n";
+    if (shiftRightStatement.by == 1) {
+        writer->write("current++;\n");
+    } else {
+        writer->write("current += ");
+        writer->write(shiftRightStatement.by);
+        writer->write(";\n");
+    }
+
+    if (tracksExtent) {
+        indentation();
+        writer->write("if (current > highest) highest = current;\n");
+    }
 }
 
 auto CodeGen::visitIncrementStatement(const IncrementStatement& incrementStatement) -> void {
+    split();
     indentation();
-    if (incrementStatement.by == 1)
-        builder << "memory[current]++;\n";
-    else builder << "memory[current] += " << incrementStatement.by << ";\n";
+    if (incrementStatement.by == 1) {
+        writer->write("memory[current]++;\n");
+        return;
+    }
+
+    writer->write("memory[current] += ");
+    writer->write(incrementStatement.by);
+    writer->write(";\n");
 }
 
 auto CodeGen::visitDecrementStatement(const DecrementStatement& decrementStatement) -> void {
+    split();
     indentation();
-    if (decrementStatement.by == 1)
-        builder << "memory[current]--;\n";
-    else builder << "memory[current] -= " << decrementStatement.by << ";\n";
+    if (decrementStatement.by == 1) {
+        writer->write("memory[current]--;\n");
+        return;
+    }
+
+    writer->write("memory[current] -= ");
+    writer->write(decrementStatement.by);
+    writer->write(";\n");
+}
+
+auto CodeGen::visitClosedFormStatement(const ClosedFormStatement& closedFormStatement) -> void {
+    split();
+    indentation();
+    writer->write(closedFormStatement.guarded ? "if (memory[current] != 0) {\n" : "{\n");
+    indentLevel++;
+
+    // Load every cell read up front, the assignments all see the values from before the loop.
+    auto variables = std::map<long long, long long>();
+    for (auto& [offset, polynomial] : closedFormStatement.assignments) {
+        for (auto variable : polynomial.variables())
+            variables.emplace(variable, 0);
+    }
+
+    auto index = 0ll;
+    for (auto& [offset, name] : variables) {
+        name = index++;
+        indentation();
+        writer->write("unsigned v");
+        writer->write(name);
+        writer->write(" = ");
+        cell(offset);
+        writer->write(";\n");
+    }
+
+    for (auto& [offset, polynomial] : closedFormStatement.assignments) {
+        indentation();
+        cell(offset);
+        writer->write(" = (unsigned char) (");
+
+        if (polynomial.terms.empty())
+            writer->write("0");
+
+        auto separator = "";
+        for (auto& [monomial, coefficient] : polynomial.terms) {
+            writer->write(separator);
+            separator = " + ";
+            auto factor = "";
+            if (coefficient != 1 || monomial.empty()) {
+                writer->write(coefficient);
+                writer->write("u");
+                factor = " * ";
+            }
+
+            for (auto variable : monomial) {
+                writer->write(factor);
+                writer->write("v");
+                writer->write(variables[variable]);
+                factor = " * ";
+            }
+        }
+
+        writer->write(");\n");
+    }
+
+    // The pointer itself is already covered, only cells beside it can widen the extent.
+    if (tracksExtent && closedFormStatement.lowest < 0) {
+        indentation();
+        writer->write("if (current - ");
+        writer->write(-closedFormStatement.lowest);
+        writer->write(" < lowest) lowest = current - ");
+        writer->write(-closedFormStatement.lowest);
+        writer->write(";\n");
+    }
+
+    if (tracksExtent && closedFormStatement.highest > 0) {
+        indentation();
+        writer->write("if (current + ");
+        writer->write(closedFormStatement.highest);
+        writer->write(" > highest) highest = current + ");
+        writer->write(closedFormStatement.highest);
+        writer->write(";\n");
+    }
+
+    indentLevel--;
+    indentation();
+    writer->write("}\n");
+}
+
+auto CodeGen::outline(unsigned long long index) -> void {
+    // The call site declares the function itself, so the definition can come after main.
+    indentation();
+    writer->write("{\n");
+    indentLevel++;
+    indentation();
+    writer->write("long long bfc_cold_");
+    writer->write(index);
+    writer->write("(unsigned char* memory, long long current);\n");
+    indentation();
+    writer->write("current = bfc_cold_");
+    writer->write(index);
+    writer->write("(memory, current);\n");
+    indentLevel--;
+    indentation();
+    writer->write("}\n");
+
+    if (!coldWriter)
+        coldWriter = std::make_unique<FileWriter>(path + ".cold");
+
+    std::swap(writer, coldWriter);
+    writer->write("\n\n__attribute__((cold, noinline)) long long bfc_cold_");
+    writer->write(index);
+    writer->write("(unsigned char* memory, long long current) {\n");
+
+    outlinedDepth = loopDepth;
+    outlinedIndentLevel = indentLevel;
+    indentLevel = 1;
+}
+
+auto CodeGen::appendColdFunctions() -> void {
+    if (!coldWriter)
+        return;
+
+    auto coldPath = path + ".cold";
+    coldWriter->close();
+    coldWriter = nullptr;
+
+    auto stream = std::ifstream(coldPath, std::ios::binary);
+    auto chunk = std::string(1u << 16u, '\0');
+    while (stream.read(chunk.data(), chunk.size()) || stream.gcount() > 0)
+        writer->write(std::string_view(chunk.data(), stream.gcount()));
+
+    stream.close();
+    unlink(coldPath.c_str());
+}
+
+// A loop condition hinted by how often it held out of how often it was checked.
+static auto condition(unsigned long long held, unsigned long long checked) -> const char* {
+    if (checked != 0 && held * 10 >= checked * 9)
+        return "__builtin_expect(memory[current] != 0, 1)";
+    if (checked != 0 && held * 10 <= checked)
+        return "__builtin_expect(memory[current] != 0, 0)";
+
+    return "memory[current] != 0";
 }
 
 auto CodeGen::enterLoopStatement(const LoopStatement& loopStatement) -> void {
+    split();
+    loopDepth++;
+
+    auto index = loopIndex++;
+    if (profile == nullptr || index >= profile->loops.size()) {
+        indentation();
+        writer->write("while (memory[current] != 0) {\n");
+        indentLevel++;
+        loopConditions.push_back(nullptr);
+        return;
+    }
+
+    auto& loopProfile = profile->loops[index];
+    if (loopProfile.entries == 0 && outlinedDepth == 0)
+        outline(index);
+
+    auto hot = loopProfile.iterations >= hotIterations;
+    auto trips = loopProfile.entries == 0 ? 0 : loopProfile.iterations / loopProfile.entries;
+
+    // Scanning for a zero cell to the right is what memchr is made for. The loop is still
+    // emitted after it, and simply finds the zero straight away.
+    auto scan = loopStatement.statements.size() == 1 && loopStatement.statements[0]->kind() == StatementKind::ShiftRight
+        && dynamic_cast<const ShiftRightStatement&>(*loopStatement.statements[0]).by == 1;
+    if (hot && scan && trips >= unrollTrips) {
+        indentation();
+        writer->write("current = (unsigned char*) memchr(memory + current, 0, 80000 - current) - memory;\n");
+    }
+
+    // The entry check and the back edge branch differently, a loop that is usually skipped
+    // may still run long once entered, so they are split into a guard and a do-while.
+    auto entered = loopProfile.entries - loopProfile.skipped;
+    indentation();
+    writer->write("if (");
+    writer->write(condition(entered, loopProfile.entries));
+    writer->write(") {\n");
+    indentLevel++;
+
+    if (hot && trips >= unrollTrips) {
+        indentation();
+        writer->write("#pragma GCC unroll 4\n");
+    }
+
     indentation();
-    builder << "while (memory[current] != 0) {\n";
+    writer->write("do {\n");
     indentLevel++;
+    loopConditions.push_back(condition(loopProfile.iterations - entered, loopProfile.iterations));
 }
 
 auto CodeGen::exitLoopStatement(const LoopStatement& loopStatement) -> void {
+    auto loopCondition = loopConditions.back();
+    loopConditions.pop_back();
+
     indentLevel--;
     indentation();
-    builder << "}\n";
+    if (loopCondition != nullptr) {
+        writer->write("} while (");
+        writer->write(loopCondition);
+        writer->write(");\n");
+        indentLevel--;
+        indentation();
+    }
+
+    writer->write("}\n");
+
+    if (outlinedDepth == loopDepth && outlinedDepth != 0) {
+        writer->write("  return current;\n}");
+        std::swap(writer, coldWriter);
+        indentLevel = outlinedIndentLevel;
+        outlinedDepth = 0;
+    }
+
+    loopDepth--;
 }
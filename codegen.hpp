@@ -1,22 +1,30 @@
-#include <sstream>
-#include <unordered_map>
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
 #include "ast.hpp"
+#include "profile.hpp"
+#include "writer.hpp"
 
 class CodeGen : public Listener {
 public:
-    explicit inline CodeGen() {
-        builder = {};
-        indentLevel = 1;
+    // Flushes the trailer of the program. When splitting, this is also the point
+    // where the main translation unit calling every part gets written.
+    auto finish() -> void;
 
-        builder << "// Generated by bfc\n#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n\nint main() {\n";
-        builder << "  unsigned char* memory = (unsigned char*) malloc(80000);\n  memset(memory, 0, 80000);\n  long long current = 40000;\n";
-    }
+    // A non-zero splitThreshold starts a new translation unit once the current one
+    // has grown past that many bytes, but only between top-level statements.
+    explicit CodeGen(std::string path, unsigned long long splitThreshold = 0);
 
-    inline auto toString() -> std::string {
-        indentation();
-        builder << "free(memory);\n}";
-        return builder.str();
-    }
+    // Specializes loops using the counters of a profiling run of the same tree: branch
+    // hints, unrolling and kernels for hot loops, and loops that never ran are moved
+    // out of line into cold functions appended to the main translation unit.
+    auto use(const Profile* profile) -> void;
+
+    // Writes a translation unit holding just this loop, as a function matching NativeLoop
+    // in jit.hpp. Input and output go through the NativeIo callbacks it receives.
+    static auto emitFunction(const std::string& path, const std::string& name, const LoopStatement& loopStatement) -> void;
 protected:
     auto visitPrintStatement(const PrintStatement& printStatement) -> void override;
     auto visitInputStatement(const InputStatement& inputStatement) -> void override;
@@ -24,14 +32,43 @@ protected:
     auto visitShiftRightStatement(const ShiftRightStatement& shiftLeftStatement) -> void override;
     auto visitIncrementStatement(const IncrementStatement& incrementStatement) -> void override;
     auto visitDecrementStatement(const DecrementStatement& decrementStatement) -> void override;
+    auto visitClosedFormStatement(const ClosedFormStatement& closedFormStatement) -> void override;
     auto enterLoopStatement(const LoopStatement& loopStatement) -> void override;
     auto exitLoopStatement(const LoopStatement& loopStatement) -> void override;
 private:
-    std::ostringstream builder;
-    ulong indentLevel;
+    const std::string path;
+    const unsigned long long splitThreshold;
+
+    std::unique_ptr<FileWriter> writer;
+    unsigned long long parts;
+    unsigned long indentLevel;
+    std::string indents;
+
+    const Profile* profile;
+    std::unique_ptr<FileWriter> coldWriter;
+    unsigned long long loopIndex;
+    unsigned long long loopDepth;
+    unsigned long long outlinedDepth;
+    unsigned long outlinedIndentLevel;
+    // Keeps lowest and highest up to date with every cell reached, for emitFunction.
+    bool tracksExtent;
+    // Per open loop, the condition closing a guarded do-while, or nullptr for a plain while.
+    std::vector<const char*> loopConditions;
+
+    explicit CodeGen(std::string path, std::unique_ptr<FileWriter> writer);
+
+    auto partPath(unsigned long long part) const -> std::string;
+    auto beginPart() -> void;
+    auto endPart() -> void;
+    auto split() -> void;
+    auto cell(long long offset) -> void;
+    auto outline(unsigned long long index) -> void;
+    auto appendColdFunctions() -> void;
 
     inline auto indentation() -> void {
-        for (auto i = 0; i < indentLevel; ++i)
-            builder << "  ";
+        if (indents.size() < indentLevel * 2)
+            indents.resize(indentLevel * 4, ' ');
+
+        writer->write(std::string_view(indents.data(), indentLevel * 2));
     }
 };
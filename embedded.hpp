@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// A self-contained brainfuck core that works in constant expressions, for programs
+// embedded in C++ sources. Nothing here allocates: the program, tape and output all
+// live in fixed-capacity arrays, and running out of any of them is a compile error
+// when evaluated at compile time (and an exception otherwise).
+//
+//     constexpr auto hello = evaluate<64>("++++++++[>++++[>++>+++>+++>+<<<<-]>+>+>->>+[<]<-]>>.>---.+++++++..+++.>>.<-.<.+++.------.--------.>>+.");
+//     static_assert(hello.view() == "Hello World!");
+//
+// Cells wrap around at 8 bits and reading past the end of the input stores 255, like
+// the interpreter does.
+
+enum class OperationKind {
+    Add,
+    Move,
+    Print,
+    Input,
+    Open,
+    Close
+};
+
+struct Operation {
+    OperationKind kind;
+    long long argument;
+    // For Open and Close, the index of the matching bracket.
+    std::size_t jump;
+};
+
+template<std::size_t Capacity>
+struct CompiledProgram {
+    std::array<Operation, Capacity> operations {};
+    std::size_t size = 0;
+};
+
+// Merges runs of +- and <> into single operations and matches brackets.
+template<std::size_t Capacity = 1024>
+constexpr auto compileProgram(std::string_view source) -> CompiledProgram<Capacity> {
+    auto program = CompiledProgram<Capacity>();
+    auto open = std::array<std::size_t, Capacity> {};
+    std::size_t depth = 0;
+
+    for (std::size_t i = 0; i < source.size(); i++) {
+        auto character = source[i];
+        auto kind = OperationKind::Add;
+        long long argument = 0;
+
+        switch (character) {
+            case '+': kind = OperationKind::Add; argument = 1; break;
+            case '-': kind = OperationKind::Add; argument = -1; break;
+            case '>': kind = OperationKind::Move; argument = 1; break;
+            case '<': kind = OperationKind::Move; argument = -1; break;
+            case '.': kind = OperationKind::Print; break;
+            case ',': kind = OperationKind::Input; break;
+            case '[': kind = OperationKind::Open; break;
+            case ']': kind = OperationKind::Close; break;
+            default: continue;
+        }
+
+        auto mergeable = kind == OperationKind::Add || kind == OperationKind::Move;
+        if (mergeable && program.size > 0 && program.operations[program.size - 1].kind == kind) {
+            program.operations[program.size - 1].argument += argument;
+            continue;
+        }
+
+        if (program.size == Capacity)
+            throw std::length_error("Program exceeds the operation capacity");
+
+        auto index = program.size++;
+        program.operations[index] = Operation { kind, argument, 0 };
+
+        if (kind == OperationKind::Open) {
+            open[depth++] = index;
+        } else if (kind == OperationKind::Close) {
+            if (depth == 0)
+                throw std::logic_error("Unmatched ]");
+
+            auto match = open[--depth];
+            program.operations[match].jump = index;
+            program.operations[index].jump = match;
+        }
+    }
+
+    if (depth != 0)
+        throw std::logic_error("Unexpected end of input");
+
+    return program;
+}
+
+template<std::size_t OutputCapacity>
+struct EmbeddedOutput {
+    std::array<char, OutputCapacity> data {};
+    std::size_t size = 0;
+
+    constexpr auto view() const -> std::string_view { return std::string_view(data.data(), size); }
+};
+
+// Runs a program to completion, usable in constant expressions. The pointer starts
+// in the middle of the tape.
+template<std::size_t OutputCapacity = 1024, std::size_t TapeSize = 4096, std::size_t Capacity = 1024>
+constexpr auto evaluate(std::string_view source, std::string_view input = {}) -> EmbeddedOutput<OutputCapacity> {
+    auto program = compileProgram<Capacity>(source);
+    auto output = EmbeddedOutput<OutputCapacity>();
+    auto tape = std::array<unsigned char, TapeSize> {};
+    auto pointer = static_cast<long long>(TapeSize / 2);
+    std::size_t consumed = 0;
+
+    for (std::size_t pc = 0; pc < program.size; pc++) {
+        auto& operation = program.operations[pc];
+        switch (operation.kind) {
+            case OperationKind::Add:
+                tape[pointer] = static_cast<unsigned char>(tape[pointer] + operation.argument);
+                break;
+            case OperationKind::Move:
+                pointer += operation.argument;
+                if (pointer < 0 || pointer >= static_cast<long long>(TapeSize))
+                    throw std::out_of_range("Pointer left the tape");
+                break;
+            case OperationKind::Print:
+                if (output.size == OutputCapacity)
+                    throw std::length_error("Output exceeds the output capacity");
+                output.data[output.size++] = static_cast<char>(tape[pointer]);
+                break;
+            case OperationKind::Input:
+                tape[pointer] = consumed < input.size() ? static_cast<unsigned char>(input[consumed++]) : 255;
+                break;
+            case OperationKind::Open:
+                if (tape[pointer] == 0)
+                    pc = operation.jump;
+                break;
+            case OperationKind::Close:
+                if (tape[pointer] != 0)
+                    pc = operation.jump;
+                break;
+        }
+    }
+
+    return output;
+}
+
+// Expands a program known at compile time into straight-line code with native loops,
+// so nothing is decoded at run time. Source must have static storage duration:
+//
+//     static constexpr char reverse[] = ">,[>,]<[.<]";
+//     auto output = EmbeddedProgram<reverse>::run("abc");
+//
+// Every operation adds a level of template instantiation, long programs may need a
+// larger -ftemplate-depth. The tape is not bounds checked, just like the C output.
+template<const char* Source, std::size_t TapeSize = 30000, std::size_t Capacity = 1024>
+class EmbeddedProgram {
+public:
+    static constexpr auto program = compileProgram<Capacity>(std::string_view(Source));
+
+    static auto run(std::string_view input = {}) -> std::string {
+        auto state = State { {}, TapeSize / 2, input, 0, {} };
+        execute<0, program.size>(state);
+        return state.output;
+    }
+private:
+    struct State {
+        std::array<unsigned char, TapeSize> tape;
+        std::size_t pointer;
+        std::string_view input;
+        std::size_t consumed;
+        std::string output;
+    };
+
+    template<std::size_t Pc, std::size_t End>
+    static auto execute(State& state) -> void {
+        if constexpr (Pc < End) {
+            constexpr auto operation = program.operations[Pc];
+
+            if constexpr (operation.kind == OperationKind::Open) {
+                while (state.tape[state.pointer] != 0)
+                    execute<Pc + 1, operation.jump>(state);
+
+                execute<operation.jump + 1, End>(state);
+            } else {
+                if constexpr (operation.kind == OperationKind::Add)
+                    state.tape[state.pointer] += static_cast<unsigned char>(operation.argument);
+                else if constexpr (operation.kind == OperationKind::Move)
+                    state.pointer += operation.argument;
+                else if constexpr (operation.kind == OperationKind::Print)
+                    state.output.push_back(static_cast<char>(state.tape[state.pointer]));
+                else if constexpr (operation.kind == OperationKind::Input)
+                    state.tape[state.pointer] = state.consumed < state.input.size() ? state.input[state.consumed++] : 255;
+
+                execute<Pc + 1, End>(state);
+            }
+        }
+    }
+};
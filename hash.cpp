@@ -0,0 +1,74 @@
+#include "hash.hpp"
+
+class ProgramHasher : public Listener {
+public:
+    Hasher hasher;
+protected:
+    auto visitPrintStatement(const PrintStatement& printStatement) -> void override { tag(StatementKind::Print); }
+    auto visitInputStatement(const InputStatement& inputStatement) -> void override { tag(StatementKind::Input); }
+
+    auto visitShiftLeftStatement(const ShiftLeftStatement& shiftLeftStatement) -> void override {
+        tag(StatementKind::ShiftLeft);
+        hasher.update(shiftLeftStatement.by);
+    }
+
+    auto visitShiftRightStatement(const ShiftRightStatement& shiftRightStatement) -> void override {
+        tag(StatementKind::ShiftRight);
+        hasher.update(shiftRightStatement.by);
+    }
+
+    auto visitIncrementStatement(const IncrementStatement& incrementStatement) -> void override {
+        tag(StatementKind::Increment);
+        hasher.update(incrementStatement.by);
+    }
+
+    auto visitDecrementStatement(const DecrementStatement& decrementStatement) -> void override {
+        tag(StatementKind::Decrement);
+        hasher.update(decrementStatement.by);
+    }
+
+    auto visitClosedFormStatement(const ClosedFormStatement& closedFormStatement) -> void override {
+        tag(StatementKind::ClosedForm);
+        hasher.update(closedFormStatement.guarded);
+        hasher.update(closedFormStatement.assignments.size());
+
+        for (auto& [offset, polynomial] : closedFormStatement.assignments) {
+            hasher.update(offset);
+            hasher.update(polynomial.terms.size());
+
+            for (auto& [monomial, coefficient] : polynomial.terms) {
+                hasher.update(coefficient);
+                hasher.update(monomial.size());
+                hasher.update(monomial.data(), monomial.size() * sizeof(long long));
+            }
+        }
+    }
+
+    auto enterLoopStatement(const LoopStatement& loopStatement) -> void override { tag(StatementKind::Loop); }
+    // Closes the loop, otherwise [+]+ and [++] would hash the same.
+    auto exitLoopStatement(const LoopStatement& loopStatement) -> void override { hasher.update('\0'); }
+private:
+    auto tag(StatementKind kind) -> void {
+        hasher.update(static_cast<char>('A' + kind));
+    }
+};
+
+auto Hasher::update(const void* data, std::size_t length) -> void {
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (auto i = 0ull; i < length; i++) {
+        state ^= bytes[i];
+        state *= 1099511628211ull;
+    }
+}
+
+Hasher::Hasher() {
+    state = 14695981039346656037ull;
+}
+
+auto hashProgram(const std::vector<std::unique_ptr<Statement>>& statements) -> unsigned long long {
+    auto programHasher = ProgramHasher();
+    for (auto& statement : statements)
+        statement->accept(programHasher);
+
+    return programHasher.hasher.digest();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "ast.hpp"
+
+// 64-bit FNV-1a, stable across runs and platforms so digests can be stored on disk.
+class Hasher {
+public:
+    auto update(const void* data, std::size_t length) -> void;
+
+    template<typename T>
+    auto update(const T& value) -> void {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+        update(&value, sizeof(value));
+    }
+
+    auto digest() const -> unsigned long long { return state; }
+
+    explicit Hasher();
+private:
+    unsigned long long state;
+};
+
+// Hashes the structure of a tree, two trees hash the same when they behave the same
+// statement for statement.
+auto hashProgram(const std::vector<std::unique_ptr<Statement>>& statements) -> unsigned long long;
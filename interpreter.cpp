@@ -1,43 +1,241 @@
+#include <algorithm>
 #include <iostream>
+#include <sys/mman.h>
 #include "interpreter.hpp"
 
+static constexpr std::size_t initialTapeSize = 1u << 16u;
+
+// Native code indexes cells without bounds checks, so tiered runs address them relative
+// to the middle of a lazily committed mapping that only takes up the pages touched.
+static constexpr std::size_t mappingSize = 1ull << 32u;
+static constexpr int64_t mappingReach = mappingSize / 2;
+
 auto Interpreter::interpret() -> void {
     for (auto& statement : statements)
         statement->accept(*this);
 }
 
+auto Interpreter::execute(Statement& statement) -> void {
+    statement.accept(*this);
+
+    // Loops are tracked by address, which a later statement may reuse.
+    tiers.clear();
+}
+
 Interpreter::Interpreter(const std::vector<std::unique_ptr<Statement>>& statements) : statements(statements) {
     cellPointer = 0;
-    cells = std::unordered_map<int64_t, byte>();
+    lowestCell = 0;
+    highestCell = 0;
+    instructions = 0;
+    results = {};
+    loopCompiler = nullptr;
+    threshold = 0;
+    tiers = {};
+    loopProfiles = nullptr;
+    input = &std::cin;
+    output = &std::cout;
+
+    tape = std::vector<byte>(initialTapeSize, 0);
+    origin = initialTapeSize / 2;
+    mapping = nullptr;
+    cells = tape.data() + origin;
+}
+
+Interpreter::~Interpreter() {
+    if (mapping != nullptr)
+        munmap(mapping, mappingSize);
+}
+
+auto Interpreter::tier(LoopCompiler* loopCompiler, unsigned long long threshold) -> bool {
+    if (mapping == nullptr) {
+        if (lowestCell < -mappingReach || highestCell >= mappingReach)
+            return false;
+
+        auto address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (address == MAP_FAILED)
+            return false;
+
+        mapping = static_cast<byte*>(address);
+        std::copy(cells + lowestCell, cells + highestCell + 1, mapping + mappingReach + lowestCell);
+        cells = mapping + mappingReach;
+        tape = {};
+    }
+
+    this->loopCompiler = loopCompiler;
+    this->threshold = threshold;
+    return true;
+}
+
+auto Interpreter::reserve() -> void {
+    if (mapping != nullptr) {
+        if (lowestCell >= -mappingReach && highestCell < mappingReach)
+            return;
+
+        // Native code cannot follow the pointer this far, so interpreting goes on alone.
+        untier();
+    }
+
+    auto size = static_cast<int64_t>(tape.size());
+    if (lowestCell + origin < 0) {
+        auto missing = std::max(-(lowestCell + origin), size);
+        tape.insert(tape.begin(), missing, 0);
+        origin += missing;
+        size += missing;
+    }
+
+    if (highestCell + origin >= size)
+        tape.resize(size + std::max(highestCell + origin - size + 1, size), 0);
+
+    cells = tape.data() + origin;
+}
+
+auto Interpreter::untier() -> void {
+    // Only the cells that were inside the mapping hold anything.
+    auto low = std::max(lowestCell, -mappingReach);
+    auto high = std::min(highestCell, mappingReach - 1);
+    tape = std::vector<byte>(cells + low, cells + high + 1);
+    origin = -low;
+    cells = tape.data() + origin;
+
+    munmap(mapping, mappingSize);
+    mapping = nullptr;
+
+    // Loops still running hold on to their tiers, so those stay and only lose their code.
+    loopCompiler = nullptr;
+    for (auto& [loopStatement, loopTier] : tiers)
+        loopTier.native = nullptr;
+}
+
+auto Interpreter::profile(std::unordered_map<const LoopStatement*, LoopProfile>* loopProfiles) -> void {
+    this->loopProfiles = loopProfiles;
+}
+
+auto Interpreter::redirect(std::istream& input, std::ostream& output) -> void {
+    this->input = &input;
+    this->output = &output;
 }
 
 auto Interpreter::visit(const PrintStatement& printStatement) -> void {
-    std::cout << cells[cellPointer];
+    instructions++;
+    output->put(static_cast<char>(cells[cellPointer]));
 }
 
 auto Interpreter::visit(const InputStatement& inputStatement) -> void {
-    cells[cellPointer] = getchar();
+    instructions++;
+    cells[cellPointer] = input->get();
 }
 
 auto Interpreter::visit(const ShiftLeftStatement& shiftLeftStatement) -> void {
+    instructions++;
     cellPointer -= shiftLeftStatement.by;
+    if (cellPointer < lowestCell) {
+        lowestCell = cellPointer;
+        reserve();
+    }
 }
 
 auto Interpreter::visit(const ShiftRightStatement& shiftRightStatement) -> void {
+    instructions++;
     cellPointer += shiftRightStatement.by;
+    if (cellPointer > highestCell) {
+        highestCell = cellPointer;
+        reserve();
+    }
 }
 
 auto Interpreter::visit(const LoopStatement& loopStatement) -> void {
+    instructions++;
+    if (loopProfiles != nullptr) {
+        auto& loopProfile = (*loopProfiles)[&loopStatement];
+        loopProfile.entries++;
+        loopProfile.skipped += cells[cellPointer] == 0;
+
+        while (cells[cellPointer] != 0) {
+            for (auto& statement : loopStatement.statements)
+                statement->accept(*this);
+
+            instructions++;
+            loopProfile.iterations++;
+        }
+
+        return;
+    }
+
+    if (loopCompiler == nullptr) {
+        while (cells[cellPointer] != 0) {
+            for (auto& statement : loopStatement.statements)
+                statement->accept(*this);
+
+            instructions++;
+        }
+
+        return;
+    }
+
+    auto& loopTier = tiers[&loopStatement];
     while (cells[cellPointer] != 0) {
+        if (loopTier.native != nullptr) {
+            run(loopStatement, loopTier.native);
+            return;
+        }
+
         for (auto& statement : loopStatement.statements)
             statement->accept(*this);
+
+        instructions++;
+        if (++loopTier.iterations == threshold && loopCompiler != nullptr)
+            loopTier.native = loopCompiler->compile(loopStatement);
+    }
+}
+
+auto Interpreter::run(const LoopStatement& loopStatement, NativeLoop native) -> void {
+    auto io = NativeIo { this, nativeGet, nativePut };
+    long long extent[] = { lowestCell, highestCell };
+    cellPointer = native(cells, cellPointer, &io, extent);
+
+    if (extent[0] < lowestCell || extent[1] > highestCell) {
+        lowestCell = extent[0];
+        highestCell = extent[1];
+        reserve();
     }
 }
 
 auto Interpreter::visit(const IncrementStatement& incrementStatement) -> void {
+    instructions++;
     cells[cellPointer] += incrementStatement.by;
 }
 
 auto Interpreter::visit(const DecrementStatement& decrementStatement) -> void {
+    instructions++;
     cells[cellPointer] -= decrementStatement.by;
 }
+
+auto Interpreter::visit(const ClosedFormStatement& closedFormStatement) -> void {
+    instructions++;
+    if (closedFormStatement.guarded && cells[cellPointer] == 0)
+        return;
+
+    // The folded loop would have walked over every cell it touches.
+    int64_t low = cellPointer + closedFormStatement.lowest;
+    int64_t high = cellPointer + closedFormStatement.highest;
+    if (low < lowestCell || high > highestCell) {
+        lowestCell = std::min(lowestCell, low);
+        highestCell = std::max(highestCell, high);
+        reserve();
+    }
+
+    results.clear();
+    for (auto& [offset, polynomial] : closedFormStatement.assignments)
+        results.push_back(polynomial.evaluate([&](long long variable) { return cells[cellPointer + variable]; }));
+
+    for (std::size_t i = 0; i < results.size(); i++)
+        cells[cellPointer + closedFormStatement.assignments[i].first] = results[i];
+}
+
+auto Interpreter::nativeGet(void* context) -> int {
+    return static_cast<Interpreter*>(context)->input->get();
+}
+
+auto Interpreter::nativePut(void* context, int character) -> void {
+    static_cast<Interpreter*>(context)->output->put(static_cast<char>(character));
+}
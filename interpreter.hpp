@@ -1,15 +1,40 @@
 #pragma once
 
+#include <istream>
+#include <ostream>
 #include <unordered_map>
 #include "ast.hpp"
+#include "jit.hpp"
+#include "profile.hpp"
 
 using byte = unsigned char;
 
 class Interpreter : public Visitor {
 public:
     auto interpret() -> void;
+    // Runs a single top-level statement that the caller is free to destroy afterwards.
+    auto execute(Statement& statement) -> void;
+
+    // Statements run so far, loops count once per evaluation of their condition.
+    auto executed() const -> unsigned long long { return instructions; }
+    // Lowest and highest cell the pointer has reached.
+    auto lowest() const -> int64_t { return lowestCell; }
+    auto highest() const -> int64_t { return highestCell; }
+
+    // Compiles loops to native code once they have run threshold iterations. Statements
+    // executed natively are not counted by executed(). Returns false, leaving the
+    // interpreter as it was, when the tape cannot be mapped for native code.
+    auto tier(LoopCompiler* loopCompiler, unsigned long long threshold) -> bool;
+    // Records per-loop counters into loopProfiles while running, see Profile::collect.
+    auto profile(std::unordered_map<const LoopStatement*, LoopProfile>* loopProfiles) -> void;
+    // Reads and writes through these instead of stdin and stdout.
+    auto redirect(std::istream& input, std::ostream& output) -> void;
 
     explicit Interpreter(const std::vector<std::unique_ptr<Statement>>& statements);
+    Interpreter(const Interpreter&) = delete;
+    auto operator =(const Interpreter&) -> Interpreter& = delete;
+
+    ~Interpreter();
 
     auto visit(const PrintStatement& printStatement) -> void override;
     auto visit(const InputStatement& inputStatement) -> void override;
@@ -18,9 +43,39 @@ public:
     auto visit(const LoopStatement& loopStatement) -> void override;
     auto visit(const IncrementStatement& incrementStatement) -> void override;
     auto visit(const DecrementStatement& decrementStatement) -> void override;
+    auto visit(const ClosedFormStatement& closedFormStatement) -> void override;
 private:
+    struct LoopTier {
+        unsigned long long iterations;
+        NativeLoop native;
+    };
+
     const std::vector<std::unique_ptr<Statement>>& statements;
+    std::istream* input;
+    std::ostream* output;
 
     int64_t cellPointer;
-    std::unordered_map<int64_t, byte> cells;
+    int64_t lowestCell;
+    int64_t highestCell;
+    unsigned long long instructions;
+    // Cells from lowestCell to highestCell, tape[origin] being cell 0. Tiered runs keep
+    // them in mapping instead. Either way cells points at cell 0.
+    std::vector<byte> tape;
+    int64_t origin;
+    byte* mapping;
+    byte* cells;
+    std::vector<byte> results;
+
+    LoopCompiler* loopCompiler;
+    unsigned long long threshold;
+    std::unordered_map<const LoopStatement*, LoopTier> tiers;
+    std::unordered_map<const LoopStatement*, LoopProfile>* loopProfiles;
+
+    auto run(const LoopStatement& loopStatement, NativeLoop native) -> void;
+    // Makes room for the cells between lowestCell and highestCell.
+    auto reserve() -> void;
+    auto untier() -> void;
+
+    static auto nativeGet(void* context) -> int;
+    static auto nativePut(void* context, int character) -> void;
 };
@@ -0,0 +1,51 @@
+#include <cstdlib>
+#include <stdexcept>
+#include <dlfcn.h>
+#include <unistd.h>
+#include "codegen.hpp"
+#include "jit.hpp"
+
+auto LoopCompiler::compile(const LoopStatement& loopStatement) -> NativeLoop {
+    if (directory.empty())
+        return nullptr;
+
+    auto name = "bfc_loop_" + std::to_string(attempts++);
+    auto source = directory + "/" + name + ".c";
+    auto object = directory + "/" + name + ".so";
+
+    try {
+        CodeGen::emitFunction(source, name, loopStatement);
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
+
+    auto command = compiler + " -O2 -shared -fPIC -w -o '" + object + "' '" + source + "' >/dev/null 2>&1";
+    auto status = std::system(command.c_str());
+    unlink(source.c_str());
+    if (status != 0)
+        return nullptr;
+
+    auto handle = dlopen(object.c_str(), RTLD_NOW | RTLD_LOCAL);
+    unlink(object.c_str());
+    if (handle == nullptr)
+        return nullptr;
+
+    handles.push_back(handle);
+    return reinterpret_cast<NativeLoop>(dlsym(handle, name.c_str()));
+}
+
+LoopCompiler::LoopCompiler(std::string compiler) : compiler(std::move(compiler)) {
+    attempts = 0;
+    handles = {};
+
+    char pattern[] = "/tmp/bfc-jit-XXXXXX";
+    directory = mkdtemp(pattern) == nullptr ? "" : pattern;
+}
+
+LoopCompiler::~LoopCompiler() {
+    for (auto handle : handles)
+        dlclose(handle);
+
+    if (!directory.empty())
+        rmdir(directory.c_str());
+}
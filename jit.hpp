@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ast.hpp"
+
+// How compiled code reaches the interpreter's input and output.
+struct NativeIo {
+    void* context;
+    int (*get)(void* context);
+    void (*put)(void* context, int character);
+};
+
+// Runs the loop to completion starting at memory[current] and returns the final pointer.
+// extent holds the lowest and highest cell reached so far and is widened to every cell
+// the loop touches.
+using NativeLoop = long long (*)(unsigned char* memory, long long current, const NativeIo* io, long long* extent);
+
+// Compiles single loops to shared objects with the system C compiler and loads them.
+class LoopCompiler {
+public:
+    // Returns nullptr when the compiler is missing or fails, the caller keeps interpreting.
+    auto compile(const LoopStatement& loopStatement) -> NativeLoop;
+
+    auto compiled() const -> unsigned long long { return handles.size(); }
+
+    explicit LoopCompiler(std::string compiler);
+    LoopCompiler(const LoopCompiler&) = delete;
+    auto operator =(const LoopCompiler&) -> LoopCompiler& = delete;
+
+    ~LoopCompiler();
+private:
+    const std::string compiler;
+    std::string directory;
+    std::vector<void*> handles;
+    unsigned long long attempts;
+};
@@ -10,14 +10,14 @@ auto TokenStream::lookahead() -> Token {
     if (stash)
         return stash.value();
 
-    auto token = supplier();
+    auto token = pull();
     stash.emplace(token);
     return token;
 }
 
 auto TokenStream::next() -> Token {
     if (!stash)
-        return supplier();
+        return pull();
 
     auto temp = stash.value();
     stash = std::nullopt;
@@ -26,6 +26,23 @@ auto TokenStream::next() -> Token {
 
 TokenStream::TokenStream(std::function<Token()> supplier) : supplier(std::move(supplier)) {
     stash = std::nullopt;
+    count = 0;
+    spent = std::chrono::steady_clock::duration::zero();
+    timed = false;
+}
+
+auto TokenStream::pull() -> Token {
+    if (!timed) {
+        auto token = supplier();
+        count += token.type != TokenKind::EndOfFile;
+        return token;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto token = supplier();
+    spent += std::chrono::steady_clock::now() - start;
+    count += token.type != TokenKind::EndOfFile;
+    return token;
 }
 
 auto Lexer::lex() -> TokenStream {
@@ -80,6 +97,9 @@ auto FileLexer::supply() -> char {
         return '\0';
 
     position++;
+    if (starve && stream.rdbuf()->in_avail() <= 0)
+        starve();
+
     auto data = stream.get();
     if (data == -1) {
         done = true;
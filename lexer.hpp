@@ -4,6 +4,7 @@
 #include <functional>
 #include <optional>
 #include <fstream>
+#include <chrono>
 
 struct TextSpan {
     unsigned long long begin;
@@ -40,17 +41,34 @@ public:
 
     auto next() -> Token;
 
+    // Number of tokens (excluding end of file) pulled out of the lexer so far.
+    auto produced() const -> unsigned long long { return count; }
+    // Time spent lexing, only measured after measure(true) since it costs two clock reads per token.
+    auto elapsed() const -> std::chrono::steady_clock::duration { return spent; }
+    auto measure(bool enabled) -> void { timed = enabled; }
+
     explicit TokenStream(std::function<Token()> supplier);
 private:
     const std::function<Token()> supplier;
     std::optional<Token> stash;
+    unsigned long long count;
+    std::chrono::steady_clock::duration spent;
+    bool timed;
+
+    auto pull() -> Token;
 };
 
 class Lexer {
 public:
+    virtual ~Lexer() = default;
+
     auto lex() -> TokenStream;
+
+    // Called before the lexer may block waiting for more source, e.g. to flush output.
+    auto onStarve(std::function<void()> callback) -> void { starve = std::move(callback); }
 protected:
     unsigned long long position{};
+    std::function<void()> starve;
 
     virtual auto supply() -> char = 0;
 };
@@ -4,6 +4,16 @@
 #include "utils.hpp"
 #include "interpreter.hpp"
 #include "codegen.hpp"
+#include "stats.hpp"
+#include "closedform.hpp"
+#include "jit.hpp"
+#include "hash.hpp"
+#include "profile.hpp"
+#include "cache.hpp"
+#include "batch.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
 
 auto mapOption(std::unordered_map<std::string, Switch*>& coll, Switch* sw) -> void {
     for (const std::string& identifier : sw->identifiers())
@@ -32,6 +42,72 @@ auto createLexer(CommandLineParseResult parseResult, Option* eval, Option* file)
     }
 }
 
+// Executes top-level statements as soon as they are parsed, so only a loop that is
+// still being parsed is ever held in memory.
+auto stream(TokenStream& tokenStream, Interpreter& interpreter, Statistics& statistics, bool fold, bool count) -> void {
+    auto parser = Parser(tokenStream);
+    auto parsing = std::chrono::steady_clock::duration::zero();
+    auto folding = std::chrono::steady_clock::duration::zero();
+    auto executing = std::chrono::steady_clock::duration::zero();
+
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        auto statement = parser.next();
+        auto parsed = std::chrono::steady_clock::now();
+        parsing += parsed - start;
+
+        if (!statement)
+            break;
+
+        if (fold)
+            foldClosedForms(statement);
+        if (count)
+            statistics.count(*statement);
+
+        auto folded = std::chrono::steady_clock::now();
+        folding += folded - parsed;
+
+        interpreter.execute(*statement);
+        executing += std::chrono::steady_clock::now() - folded;
+    }
+
+    statistics.record("lex", tokenStream.elapsed());
+    statistics.record("parse", parsing - tokenStream.elapsed());
+    if (fold)
+        statistics.record("closed-form", folding);
+    statistics.record("execute", executing);
+}
+
+// Runs the program over every file in a directory, writing each output under the same
+// name into another directory.
+auto runBatch(const std::vector<std::unique_ptr<Statement>>& statements, const std::string& inputDirectory,
+              const std::string& outputDirectory, std::size_t lanes) -> void {
+    auto names = std::vector<std::filesystem::path>();
+    for (auto& entry : std::filesystem::directory_iterator(inputDirectory)) {
+        if (entry.is_regular_file())
+            names.push_back(entry.path().filename());
+    }
+    std::sort(names.begin(), names.end());
+
+    auto inputs = std::vector<std::string>();
+    for (auto& name : names) {
+        auto stream = std::ifstream(std::filesystem::path(inputDirectory) / name, std::ios::binary);
+        auto contents = std::ostringstream();
+        contents << stream.rdbuf();
+        inputs.push_back(contents.str());
+    }
+
+    auto outputs = BatchInterpreter(statements, lanes).run(inputs);
+
+    std::filesystem::create_directories(outputDirectory);
+    for (std::size_t i = 0; i < names.size(); i++) {
+        auto stream = std::ofstream(std::filesystem::path(outputDirectory) / names[i], std::ios::binary);
+        stream << outputs[i];
+        if (!stream.good())
+            throw std::runtime_error("Failed to write batch output");
+    }
+}
+
 auto main(int argc, char* argv[]) -> int {
     std::unordered_map<std::string, Switch*> switches {};
     auto help = addOption<Flag>(switches, "-h", "--help");
@@ -39,6 +115,20 @@ auto main(int argc, char* argv[]) -> int {
     auto eval = addOption<Option>(switches, "", "-e", "--eval");
     auto file = addOption<Option>(switches, "", "-f", "--file");
     auto pseudoCode = addOption<Option>(switches, "", "-o", "--output");
+    auto splitOutput = addOption<Option>(switches, "0", "--split-output");
+    auto stats = addOption<Flag>(switches, "--stats");
+    auto timePasses = addOption<Flag>(switches, "--time-passes");
+    auto statsFormat = addOption<Option>(switches, "text", "--stats-format");
+    auto noClosedForm = addOption<Flag>(switches, "--no-closed-form");
+    auto tiered = addOption<Flag>(switches, "--tiered");
+    auto jitThreshold = addOption<Option>(switches, "10000", "--jit-threshold");
+    auto profileGenerate = addOption<Option>(switches, "", "--profile-generate");
+    auto profileUse = addOption<Option>(switches, "", "--profile-use");
+    auto cacheDirectory = addOption<Option>(switches, "", "--cache");
+    auto streaming = addOption<Flag>(switches, "--stream");
+    auto batch = addOption<Option>(switches, "", "--batch");
+    auto batchOutput = addOption<Option>(switches, "", "--batch-output");
+    auto batchLanes = addOption<Option>(switches, "64", "--batch-lanes");
 
     auto cliParser = CommandLineParser(switches, argc, argv);
     auto result = cliParser.parse();
@@ -53,6 +143,20 @@ auto main(int argc, char* argv[]) -> int {
         std::cout << "   " << "-e --eval          " << "Evaluates the provided brainfuck program\n";
         std::cout << "   " << "-f --file          " << "Evaluates a brainfuck program from a file\n";
         std::cout << "   " << "-o --output        " << "Dumps C pseudocode to a file\n";
+        std::cout << "   " << "--split-output     " << "Splits the C output into translation units of about N bytes\n";
+        std::cout << "   " << "--stats            " << "Reports token, node, instruction and memory counters\n";
+        std::cout << "   " << "--time-passes      " << "Reports the wall time of every phase\n";
+        std::cout << "   " << "--stats-format     " << "Format of the reports, text or json\n";
+        std::cout << "   " << "--no-closed-form   " << "Keeps balanced loops instead of computing their result directly\n";
+        std::cout << "   " << "--tiered           " << "Compiles hot loops to native code while interpreting\n";
+        std::cout << "   " << "--jit-threshold    " << "Iterations after which --tiered compiles a loop\n";
+        std::cout << "   " << "--profile-generate " << "Records loop counters of this run into a profile file\n";
+        std::cout << "   " << "--profile-use      " << "Specializes the C output of -o using a profile file\n";
+        std::cout << "   " << "--cache            " << "Replays the output of identical earlier runs from a directory\n";
+        std::cout << "   " << "--stream           " << "Executes statements while the rest of the program is parsed\n";
+        std::cout << "   " << "--batch            " << "Runs the program over every input file in a directory at once\n";
+        std::cout << "   " << "--batch-output     " << "Directory receiving the outputs of --batch\n";
+        std::cout << "   " << "--batch-lanes      " << "Number of inputs --batch runs in lockstep\n";
         return 0;
     }
 
@@ -61,10 +165,86 @@ auto main(int argc, char* argv[]) -> int {
         return -1;
     }
 
+    if (result.hasOption(*profileGenerate) && result.hasFlag(*tiered)) {
+        std::cerr << "--profile-generate cannot count loops running as native code, drop --tiered\n";
+        return -1;
+    }
+
+    if (result.hasOption(*profileGenerate) && result.hasOption(*pseudoCode)) {
+        std::cerr << "--profile-generate needs the program to run, -o only emits C\n";
+        return -1;
+    }
+
+    if (result.hasOption(*profileGenerate) && result.hasOption(*cacheDirectory)) {
+        std::cerr << "--profile-generate needs the program to run, drop --cache\n";
+        return -1;
+    }
+
+    auto needsWholeProgram = result.hasOption(*pseudoCode) || result.hasFlag(*prettyPrint)
+        || result.hasOption(*profileGenerate) || result.hasOption(*cacheDirectory);
+    if (result.hasFlag(*streaming) && needsWholeProgram) {
+        std::cerr << "--stream cannot be combined with -o, --pretty-print-ast, --profile-generate or --cache\n";
+        return -1;
+    }
+
+    auto excludesBatch = result.hasOption(*pseudoCode) || result.hasFlag(*streaming) || result.hasFlag(*tiered)
+        || result.hasOption(*profileGenerate) || result.hasOption(*cacheDirectory);
+    if (result.hasOption(*batch) && (excludesBatch || !result.hasOption(*batchOutput))) {
+        std::cerr << "--batch needs --batch-output and cannot be combined with -o, --stream, --tiered, --profile-generate or --cache\n";
+        return -1;
+    }
+
+    auto statistics = Statistics();
+    auto reportStatistics = [&]() {
+        if (!result.hasFlag(*stats) && !result.hasFlag(*timePasses))
+            return;
+
+        std::cout.flush();
+        statistics.report(std::cerr, result.hasFlag(*stats), result.hasFlag(*timePasses), result.getValue(*statsFormat) == "json");
+    };
+
     auto lexer = createLexer(result, eval.get(), file.get());
     auto tokenStream = lexer->lex();
+    tokenStream.measure(result.hasFlag(*timePasses));
     auto parser = Parser(tokenStream);
+    auto compilerPath = std::getenv("CC");
+
+    if (result.hasFlag(*streaming)) {
+        auto none = std::vector<std::unique_ptr<Statement>>();
+        auto loopCompiler = std::unique_ptr<LoopCompiler>();
+        auto interpreter = Interpreter(none);
+        if (result.hasFlag(*tiered)) {
+            loopCompiler = std::make_unique<LoopCompiler>(compilerPath == nullptr ? "cc" : compilerPath);
+            if (!interpreter.tier(loopCompiler.get(), std::stoull(result.getValue(*jitThreshold))))
+                std::cerr << "Failed to map the tape for --tiered, interpreting only\n";
+        }
+
+        // Whatever the program printed so far should not wait for the rest of the source.
+        lexer->onStarve([]() { std::cout.flush(); });
+        stream(tokenStream, interpreter, statistics, !result.hasFlag(*noClosedForm), result.hasFlag(*stats));
+
+        statistics.tokens = tokenStream.produced();
+        statistics.executed = interpreter.executed();
+        if (loopCompiler)
+            statistics.compiled = loopCompiler->compiled();
+        statistics.tape = std::make_pair(interpreter.lowest(), interpreter.highest());
+        reportStatistics();
+        return 0;
+    }
+
+    auto parseStart = std::chrono::steady_clock::now();
     auto statements = parser.parse();
+    auto parseElapsed = std::chrono::steady_clock::now() - parseStart;
+
+    statistics.record("lex", tokenStream.elapsed());
+    statistics.record("parse", parseElapsed - tokenStream.elapsed());
+    statistics.tokens = tokenStream.produced();
+
+    if (!result.hasFlag(*noClosedForm))
+        statistics.time("closed-form", [&]() { foldClosedForms(statements); });
+
+    if (result.hasFlag(*stats))
+        statistics.count(statements);
 
     if (result.hasFlag(*prettyPrint)) {
         if (statements.empty())
@@ -77,18 +257,106 @@ auto main(int argc, char* argv[]) -> int {
     }
 
     if (result.hasOption(*pseudoCode)) {
-        auto output = std::ofstream(result.getValue(*pseudoCode));
-        auto generator = CodeGen();
-        for (auto& stmt : statements)
-            stmt->accept(generator);
+        auto profile = std::optional<Profile>();
+        if (result.hasOption(*profileUse)) {
+            try {
+                profile = Profile::load(result.getValue(*profileUse));
+            } catch (const std::runtime_error& error) {
+                std::cerr << "Failed to read the profile (" << error.what() << "), ignoring it\n";
+            }
+
+            if (profile && profile->program != hashProgram(statements)) {
+                std::cerr << "The profile was recorded for a different program, ignoring it\n";
+                profile = std::nullopt;
+            }
+        }
 
+        statistics.time("emit", [&]() {
+            auto generator = CodeGen(result.getValue(*pseudoCode), std::stoull(result.getValue(*splitOutput)));
+            if (profile)
+                generator.use(&*profile);
 
-        output << generator.toString();
-        output.close();
+            for (auto& stmt : statements)
+                stmt->accept(generator);
 
+            generator.finish();
+        });
+
+        reportStatistics();
         return 0;
     }
 
+    if (result.hasOption(*batch)) {
+        statistics.time("batch", [&]() {
+            runBatch(statements, result.getValue(*batch), result.getValue(*batchOutput), std::stoull(result.getValue(*batchLanes)));
+        });
+
+        reportStatistics();
+        return 0;
+    }
+
+    auto loopCompiler = std::unique_ptr<LoopCompiler>();
     auto interpreter = Interpreter(statements);
-    interpreter.interpret();
+    if (result.hasFlag(*tiered)) {
+        loopCompiler = std::make_unique<LoopCompiler>(compilerPath == nullptr ? "cc" : compilerPath);
+        if (!interpreter.tier(loopCompiler.get(), std::stoull(result.getValue(*jitThreshold))))
+            std::cerr << "Failed to map the tape for --tiered, interpreting only\n";
+    }
+
+    auto loopProfiles = std::unordered_map<const LoopStatement*, LoopProfile>();
+    if (result.hasOption(*profileGenerate))
+        interpreter.profile(&loopProfiles);
+
+    // Programs that read input can only be cached on all of it, so it is read up front.
+    auto cache = std::unique_ptr<OutputCache>();
+    auto input = std::optional<std::string>();
+    auto inputStream = std::istringstream();
+    auto tee = std::unique_ptr<TeeBuffer>();
+    auto teeStream = std::ostream(nullptr);
+    if (result.hasOption(*cacheDirectory)) {
+        if (readsInput(statements)) {
+            auto contents = std::ostringstream();
+            contents << std::cin.rdbuf();
+            input = contents.str();
+            inputStream.str(*input);
+        }
+
+        auto program = hashProgram(statements);
+        cache = std::make_unique<OutputCache>(result.getValue(*cacheDirectory));
+        statistics.cached = cache->replay(program, input);
+        if (*statistics.cached) {
+            reportStatistics();
+            return 0;
+        }
+
+        // The cache only saves work, a run it cannot store still goes ahead.
+        auto recording = cache->record(program, input);
+        if (recording != nullptr) {
+            tee = std::make_unique<TeeBuffer>(std::cout.rdbuf(), recording->rdbuf());
+            teeStream.rdbuf(tee.get());
+        } else {
+            std::cerr << "Failed to open a cache entry for writing, running without the cache\n";
+            cache = nullptr;
+        }
+
+        interpreter.redirect(input ? static_cast<std::istream&>(inputStream) : std::cin, tee ? teeStream : std::cout);
+    }
+
+    statistics.time("execute", [&]() { interpreter.interpret(); });
+    if (cache) {
+        teeStream.flush();
+        // An entry missing part of the output is dropped along with the cache.
+        if (tee->failed() || !cache->commit())
+            std::cerr << "Failed to store the cache entry\n";
+        cache = nullptr;
+    }
+
+    if (result.hasOption(*profileGenerate))
+        Profile::collect(statements, loopProfiles).save(result.getValue(*profileGenerate));
+
+    statistics.executed = interpreter.executed();
+    if (loopCompiler)
+        statistics.compiled = loopCompiler->compiled();
+    statistics.tape = std::make_pair(interpreter.lowest(), interpreter.highest());
+    reportStatistics();
 }
@@ -3,18 +3,22 @@
 auto Parser::parse() -> std::vector<std::unique_ptr<Statement>> {
     auto statements = std::vector<std::unique_ptr<Statement>>();
 
-    while (true) {
-        auto lookaheadType = tokenStream.lookahead().type;
+    while (auto statement = next())
+        statements.push_back(std::move(statement));
 
-        if (lookaheadType == TokenKind::EndOfFile)
-            break;
+    return statements;
+}
 
-        if (lookaheadType == TokenKind::LeftBracket)
-            statements.push_back(loop());
-        else statements.push_back(single());
-    }
+auto Parser::next() -> std::unique_ptr<Statement> {
+    auto lookaheadType = tokenStream.lookahead().type;
 
-    return statements;
+    if (lookaheadType == TokenKind::EndOfFile)
+        return nullptr;
+
+    if (lookaheadType == TokenKind::LeftBracket)
+        return loop();
+
+    return single();
 }
 
 auto Parser::single() -> std::unique_ptr<Statement> {
@@ -6,6 +6,8 @@
 class Parser {
 public:
     auto parse() -> std::vector<std::unique_ptr<Statement>>;
+    // Parses the next top-level statement, returns nullptr at the end of the input.
+    auto next() -> std::unique_ptr<Statement>;
     auto single() -> std::unique_ptr<Statement>;
     auto loop() -> std::unique_ptr<LoopStatement>;
 
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include "polynomial.hpp"
+
+auto Polynomial::constant(unsigned char value) -> Polynomial {
+    auto polynomial = Polynomial();
+    polynomial.add({}, value);
+    return polynomial;
+}
+
+auto Polynomial::variable(long long offset) -> Polynomial {
+    auto polynomial = Polynomial();
+    polynomial.add({ offset }, 1);
+    return polynomial;
+}
+
+auto Polynomial::isConstant() const -> bool {
+    return terms.empty() || (terms.size() == 1 && terms.begin()->first.empty());
+}
+
+auto Polynomial::constantTerm() const -> unsigned char {
+    auto search = terms.find({});
+    return search == terms.end() ? 0 : search->second;
+}
+
+auto Polynomial::references(long long offset) const -> bool {
+    for (auto& [monomial, coefficient] : terms) {
+        if (std::find(monomial.begin(), monomial.end(), offset) != monomial.end())
+            return true;
+    }
+
+    return false;
+}
+
+auto Polynomial::variables() const -> std::vector<long long> {
+    auto offsets = std::vector<long long>();
+    for (auto& [monomial, coefficient] : terms)
+        offsets.insert(offsets.end(), monomial.begin(), monomial.end());
+
+    std::sort(offsets.begin(), offsets.end());
+    offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+    return offsets;
+}
+
+auto Polynomial::shift(long long by) const -> Polynomial {
+    auto shifted = Polynomial();
+    for (auto& [monomial, coefficient] : terms) {
+        auto moved = monomial;
+        for (auto& offset : moved)
+            offset += by;
+
+        shifted.add(moved, coefficient);
+    }
+
+    return shifted;
+}
+
+auto Polynomial::substitute(const std::map<long long, Polynomial>& replacements) const -> Polynomial {
+    auto result = Polynomial();
+    for (auto& [monomial, coefficient] : terms) {
+        auto product = Polynomial::constant(coefficient);
+        for (auto offset : monomial) {
+            auto search = replacements.find(offset);
+            product = product * (search == replacements.end() ? Polynomial::variable(offset) : search->second);
+        }
+
+        result = result + product;
+    }
+
+    return result;
+}
+
+auto operator +(const Polynomial& lhs, const Polynomial& rhs) -> Polynomial {
+    auto sum = lhs;
+    for (auto& [monomial, coefficient] : rhs.terms)
+        sum.add(monomial, coefficient);
+
+    return sum;
+}
+
+auto operator -(const Polynomial& lhs, const Polynomial& rhs) -> Polynomial {
+    auto difference = lhs;
+    for (auto& [monomial, coefficient] : rhs.terms)
+        difference.add(monomial, static_cast<unsigned char>(-coefficient));
+
+    return difference;
+}
+
+auto operator *(const Polynomial& lhs, const Polynomial& rhs) -> Polynomial {
+    auto product = Polynomial();
+    for (auto& [leftMonomial, leftCoefficient] : lhs.terms) {
+        for (auto& [rightMonomial, rightCoefficient] : rhs.terms) {
+            auto monomial = Polynomial::Monomial();
+            std::merge(leftMonomial.begin(), leftMonomial.end(), rightMonomial.begin(), rightMonomial.end(), std::back_inserter(monomial));
+            product.add(monomial, static_cast<unsigned char>(leftCoefficient * rightCoefficient));
+        }
+    }
+
+    return product;
+}
+
+auto Polynomial::add(const Monomial& monomial, unsigned char coefficient) -> void {
+    if (coefficient == 0)
+        return;
+
+    auto& slot = terms[monomial];
+    slot += coefficient;
+    if (slot == 0)
+        terms.erase(monomial);
+}
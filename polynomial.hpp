@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+// A polynomial over cell values relative to some origin cell, with coefficients
+// in Z/256 so that it matches the wrap-around of 8-bit cells exactly.
+class Polynomial {
+public:
+    // Sorted cell offsets, an offset appearing twice means the variable is squared.
+    using Monomial = std::vector<long long>;
+
+    std::map<Monomial, unsigned char> terms;
+
+    static auto constant(unsigned char value) -> Polynomial;
+    static auto variable(long long offset) -> Polynomial;
+
+    auto isConstant() const -> bool;
+    auto constantTerm() const -> unsigned char;
+    auto references(long long offset) const -> bool;
+    auto variables() const -> std::vector<long long>;
+
+    // Moves every variable by the given number of cells.
+    auto shift(long long by) const -> Polynomial;
+    // Replaces variables with the polynomials provided, variables without a replacement are kept.
+    auto substitute(const std::map<long long, Polynomial>& replacements) const -> Polynomial;
+
+    template<typename F>
+    auto evaluate(F&& read) const -> unsigned char {
+        unsigned char value = 0;
+        for (auto& [monomial, coefficient] : terms) {
+            unsigned char product = coefficient;
+            for (auto offset : monomial)
+                product *= read(offset);
+
+            value += product;
+        }
+
+        return value;
+    }
+
+    friend auto operator +(const Polynomial& lhs, const Polynomial& rhs) -> Polynomial;
+    friend auto operator -(const Polynomial& lhs, const Polynomial& rhs) -> Polynomial;
+    friend auto operator *(const Polynomial& lhs, const Polynomial& rhs) -> Polynomial;
+
+    friend bool operator ==(const Polynomial& lhs, const Polynomial& rhs) {
+        return lhs.terms == rhs.terms;
+    }
+
+    friend bool operator !=(const Polynomial& lhs, const Polynomial& rhs) {
+        return !(lhs == rhs);
+    }
+private:
+    auto add(const Monomial& monomial, unsigned char coefficient) -> void;
+};
@@ -0,0 +1,68 @@
+#include <fstream>
+#include <stdexcept>
+#include "hash.hpp"
+#include "profile.hpp"
+
+static constexpr const char* header = "bfc-profile 1";
+
+class LoopCollector : public Listener {
+public:
+    std::vector<LoopProfile> loops;
+
+    explicit LoopCollector(const std::unordered_map<const LoopStatement*, LoopProfile>& counters) : counters(counters) { }
+protected:
+    auto enterLoopStatement(const LoopStatement& loopStatement) -> void override {
+        auto search = counters.find(&loopStatement);
+        loops.push_back(search == counters.end() ? LoopProfile {} : search->second);
+    }
+private:
+    const std::unordered_map<const LoopStatement*, LoopProfile>& counters;
+};
+
+auto Profile::save(const std::string& path) const -> void {
+    auto stream = std::ofstream(path);
+    if (!stream.good())
+        throw std::runtime_error("Failed to open profile for writing");
+
+    stream << header << '\n' << std::hex << program << std::dec << '\n' << loops.size() << '\n';
+    for (auto& loop : loops)
+        stream << loop.entries << ' ' << loop.skipped << ' ' << loop.iterations << '\n';
+
+    if (!stream.good())
+        throw std::runtime_error("Failed to write profile");
+}
+
+auto Profile::load(const std::string& path) -> Profile {
+    auto stream = std::ifstream(path);
+    auto line = std::string();
+    if (!std::getline(stream, line) || line != header)
+        throw std::runtime_error("Invalid profile");
+
+    unsigned long long program;
+    std::size_t count;
+    if (!(stream >> std::hex >> program >> std::dec >> count))
+        throw std::runtime_error("Invalid profile");
+
+    // Grown one loop at a time, a corrupt count must not allocate before the data runs out.
+    auto loops = std::vector<LoopProfile>();
+    for (std::size_t i = 0; i < count; i++) {
+        auto loop = LoopProfile {};
+        if (!(stream >> loop.entries >> loop.skipped >> loop.iterations))
+            throw std::runtime_error("Invalid profile");
+
+        loops.push_back(loop);
+    }
+
+    return Profile(program, std::move(loops));
+}
+
+auto Profile::collect(const std::vector<std::unique_ptr<Statement>>& statements,
+                      const std::unordered_map<const LoopStatement*, LoopProfile>& counters) -> Profile {
+    auto collector = LoopCollector(counters);
+    for (auto& statement : statements)
+        statement->accept(collector);
+
+    return Profile(hashProgram(statements), std::move(collector.loops));
+}
+
+Profile::Profile(unsigned long long program, std::vector<LoopProfile> loops) : program(program), loops(std::move(loops)) { }
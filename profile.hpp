@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.hpp"
+
+struct LoopProfile {
+    // Times the loop was reached.
+    unsigned long long entries;
+    // Entries where the condition was already false.
+    unsigned long long skipped;
+    // Times the body ran.
+    unsigned long long iterations;
+};
+
+// Loop counters of a profiling run. Loops are numbered in pre-order, which is also
+// the order CodeGen meets them in, and the program hash guards against using the
+// profile of a different tree.
+class Profile {
+public:
+    unsigned long long program;
+    std::vector<LoopProfile> loops;
+
+    auto save(const std::string& path) const -> void;
+    static auto load(const std::string& path) -> Profile;
+
+    static auto collect(const std::vector<std::unique_ptr<Statement>>& statements,
+                        const std::unordered_map<const LoopStatement*, LoopProfile>& counters) -> Profile;
+
+    explicit Profile(unsigned long long program, std::vector<LoopProfile> loops);
+};
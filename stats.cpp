@@ -0,0 +1,142 @@
+#include <sys/resource.h>
+#include "stats.hpp"
+
+class NodeCounter : public Listener {
+public:
+    explicit NodeCounter(std::unordered_map<StatementKind, unsigned long long>& nodes) : nodes(nodes) { }
+protected:
+    auto visitPrintStatement(const PrintStatement& printStatement) -> void override { nodes[StatementKind::Print]++; }
+    auto visitInputStatement(const InputStatement& inputStatement) -> void override { nodes[StatementKind::Input]++; }
+    auto visitShiftLeftStatement(const ShiftLeftStatement& shiftLeftStatement) -> void override { nodes[StatementKind::ShiftLeft]++; }
+    auto visitShiftRightStatement(const ShiftRightStatement& shiftRightStatement) -> void override { nodes[StatementKind::ShiftRight]++; }
+    auto visitIncrementStatement(const IncrementStatement& incrementStatement) -> void override { nodes[StatementKind::Increment]++; }
+    auto visitDecrementStatement(const DecrementStatement& decrementStatement) -> void override { nodes[StatementKind::Decrement]++; }
+    auto visitClosedFormStatement(const ClosedFormStatement& closedFormStatement) -> void override { nodes[StatementKind::ClosedForm]++; }
+    auto enterLoopStatement(const LoopStatement& loopStatement) -> void override { nodes[StatementKind::Loop]++; }
+private:
+    std::unordered_map<StatementKind, unsigned long long>& nodes;
+};
+
+static const StatementKind allKinds[] = {
+    StatementKind::Print,
+    StatementKind::Input,
+    StatementKind::ShiftLeft,
+    StatementKind::ShiftRight,
+    StatementKind::Loop,
+    StatementKind::Increment,
+    StatementKind::Decrement,
+    StatementKind::ClosedForm
+};
+
+static auto peakMemory() -> long {
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Kibibytes on Linux.
+}
+
+static auto seconds(std::chrono::steady_clock::duration elapsed) -> double {
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+auto Statistics::count(const std::vector<std::unique_ptr<Statement>>& statements) -> void {
+    for (auto& statement : statements)
+        count(*statement);
+}
+
+auto Statistics::count(Statement& statement) -> void {
+    auto counter = NodeCounter(nodes);
+    statement.accept(counter);
+}
+
+auto Statistics::record(const std::string& phase, std::chrono::steady_clock::duration elapsed) -> void {
+    phases.emplace_back(phase, elapsed);
+}
+
+auto Statistics::report(std::ostream& output, bool counters, bool timings, bool json) const -> void {
+    if (json)
+        reportJson(output, counters, timings);
+    else reportText(output, counters, timings);
+}
+
+Statistics::Statistics() {
+    tokens = 0;
+    nodes = {};
+    executed = std::nullopt;
+    tape = std::nullopt;
+    compiled = std::nullopt;
+    cached = std::nullopt;
+    phases = {};
+}
+
+auto Statistics::reportText(std::ostream& output, bool counters, bool timings) const -> void {
+    if (counters) {
+        output << "Statistics:\n";
+        output << "  tokens            " << tokens << '\n';
+
+        for (auto kind : allKinds) {
+            auto search = nodes.find(kind);
+            auto name = std::string(kindName(kind)) + " nodes";
+            name.resize(18, ' ');
+            output << "  " << name << (search == nodes.end() ? 0 : search->second) << '\n';
+        }
+
+        if (executed)
+            output << "  executed          " << *executed << '\n';
+        if (tape)
+            output << "  tape extent       " << tape->first << ".." << tape->second << '\n';
+        if (compiled)
+            output << "  compiled loops    " << *compiled << '\n';
+        if (cached)
+            output << "  cache             " << (*cached ? "hit" : "miss") << '\n';
+
+        output << "  peak memory       " << peakMemory() << " KiB\n";
+    }
+
+    if (timings) {
+        output << "Pass timings:\n";
+        for (auto& [phase, elapsed] : phases) {
+            auto name = phase;
+            name.resize(18, ' ');
+            output << "  " << name << seconds(elapsed) << " s\n";
+        }
+    }
+}
+
+auto Statistics::reportJson(std::ostream& output, bool counters, bool timings) const -> void {
+    output << '{';
+    auto separator = "";
+
+    if (counters) {
+        output << "\"tokens\":" << tokens << ",\"nodes\":{";
+        for (auto kind : allKinds) {
+            auto search = nodes.find(kind);
+            output << separator << '"' << kindName(kind) << "\":" << (search == nodes.end() ? 0 : search->second);
+            separator = ",";
+        }
+        output << '}';
+
+        if (executed)
+            output << ",\"executed\":" << *executed;
+        if (tape)
+            output << ",\"tape\":{\"lowest\":" << tape->first << ",\"highest\":" << tape->second << '}';
+        if (compiled)
+            output << ",\"compiledLoops\":" << *compiled;
+        if (cached)
+            output << ",\"cacheHit\":" << (*cached ? "true" : "false");
+
+        output << ",\"peakMemoryKiB\":" << peakMemory();
+        separator = ",";
+    }
+
+    if (timings) {
+        output << separator << "\"phases\":{";
+        separator = "";
+        for (auto& [phase, elapsed] : phases) {
+            output << separator << '"' << phase << "\":" << seconds(elapsed);
+            separator = ",";
+        }
+        output << '}';
+    }
+
+    output << "}\n";
+}
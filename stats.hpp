@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "ast.hpp"
+
+class Statistics {
+public:
+    unsigned long long tokens;
+    std::unordered_map<StatementKind, unsigned long long> nodes;
+    std::optional<unsigned long long> executed;
+    std::optional<std::pair<int64_t, int64_t>> tape;
+    std::optional<unsigned long long> compiled;
+    std::optional<bool> cached;
+
+    // Counts every node of the tree, loops included, by kind.
+    auto count(const std::vector<std::unique_ptr<Statement>>& statements) -> void;
+    auto count(Statement& statement) -> void;
+    auto record(const std::string& phase, std::chrono::steady_clock::duration elapsed) -> void;
+
+    template<typename F>
+    auto time(const std::string& phase, F&& action) -> decltype(action()) {
+        auto start = std::chrono::steady_clock::now();
+        if constexpr (std::is_void_v<decltype(action())>) {
+            action();
+            record(phase, std::chrono::steady_clock::now() - start);
+        } else {
+            auto result = action();
+            record(phase, std::chrono::steady_clock::now() - start);
+            return result;
+        }
+    }
+
+    auto report(std::ostream& output, bool counters, bool timings, bool json) const -> void;
+
+    explicit Statistics();
+private:
+    std::vector<std::pair<std::string, std::chrono::steady_clock::duration>> phases;
+
+    auto reportText(std::ostream& output, bool counters, bool timings) const -> void;
+    auto reportJson(std::ostream& output, bool counters, bool timings) const -> void;
+};
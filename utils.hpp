@@ -6,18 +6,8 @@
 #include <codecvt>
 
 auto prettyPrintStatement(const std::unique_ptr<Statement>& statement, std::string indent) -> void {
-    static std::unordered_map<StatementKind, std::string> kindToText = {
-        { StatementKind::Print, "Print" },
-        { StatementKind::Input, "Input" },
-        { StatementKind::ShiftLeft, "ShiftLeft" },
-        { StatementKind::ShiftRight, "ShiftRight" },
-        { StatementKind::Loop, "Loop" },
-        { StatementKind::Increment, "Increment" },
-        { StatementKind::Decrement, "Decrement" }
-    };
-
     std::cout << indent;
-    std::cout << kindToText[statement->kind()] << std::endl;
+    std::cout << kindName(statement->kind()) << '\n';
 
     indent += "  ";
 
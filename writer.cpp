@@ -0,0 +1,77 @@
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "writer.hpp"
+
+auto FileWriter::write(std::string_view text) -> void {
+    total += text.size();
+
+    if (used + text.size() > capacity)
+        flush();
+
+    // Chunks larger than the whole buffer go straight to the descriptor.
+    if (text.size() > capacity) {
+        drain(text.data(), text.size());
+        return;
+    }
+
+    std::memcpy(buffer.get() + used, text.data(), text.size());
+    used += text.size();
+}
+
+auto FileWriter::write(long long value) -> void {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    write(std::string_view(digits, result.ptr - digits));
+}
+
+auto FileWriter::flush() -> void {
+    // Nothing is kept on failure, the output file is broken either way.
+    auto size = used;
+    used = 0;
+    drain(buffer.get(), size);
+}
+
+auto FileWriter::drain(const char* data, std::size_t size) -> void {
+    while (size > 0) {
+        auto count = ::write(descriptor, data, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            throw std::runtime_error("Failed to write output file");
+
+        data += count;
+        size -= count;
+    }
+}
+
+auto FileWriter::close() -> void {
+    if (descriptor < 0)
+        return;
+
+    flush();
+    auto status = ::close(descriptor);
+    descriptor = -1;
+
+    if (status != 0)
+        throw std::runtime_error("Failed to close output file");
+}
+
+FileWriter::FileWriter(const std::string& path) : buffer(std::make_unique<char[]>(capacity)) {
+    used = 0;
+    total = 0;
+    descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0)
+        throw std::runtime_error("Failed to open output file");
+}
+
+FileWriter::~FileWriter() {
+    try {
+        close();
+    } catch (const std::runtime_error&) {
+        // Destructors must not throw, callers wanting the error use close().
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+class FileWriter {
+public:
+    static constexpr std::size_t capacity = 1u << 20u;
+
+    auto write(std::string_view text) -> void;
+    auto write(long long value) -> void;
+    auto flush() -> void;
+    auto close() -> void;
+
+    auto written() const -> unsigned long long { return total; }
+
+    explicit FileWriter(const std::string& path);
+    FileWriter(const FileWriter&) = delete;
+    auto operator =(const FileWriter&) -> FileWriter& = delete;
+
+    ~FileWriter();
+private:
+    int descriptor;
+    std::unique_ptr<char[]> buffer;
+    std::size_t used;
+    unsigned long long total;
+
+    // Writes everything to the descriptor, retrying writes interrupted by a signal.
+    auto drain(const char* data, std::size_t size) -> void;
+};